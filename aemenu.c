@@ -14,7 +14,7 @@
 
 void *item_make_cmd_cb(void *, char *, char *);
 void item_make_cli(GtkWidget *, Window);
-void fork_exec_cb(GtkWidget *, char *);
+void spawn_cb(GtkWidget *, char *);
 void win_raise_cb(GtkWidget *, Window);
 
 int main(int argc, char **argv)
@@ -77,7 +77,7 @@ void *item_make_cmd_cb(void *menu, char *label, char *cmd)
 
     if (cmd) {
         gtk_signal_connect(GTK_OBJECT(item), "activate",
-            GTK_SIGNAL_FUNC(fork_exec_cb), cmd);
+            GTK_SIGNAL_FUNC(spawn_cb), cmd);
     } else {
         sub_menu = gtk_menu_new();
         gtk_menu_item_set_submenu(GTK_MENU_ITEM(item), sub_menu);
@@ -102,9 +102,9 @@ void item_make_cli(GtkWidget *menu, Window w)
     }
 }
 
-void fork_exec_cb(GtkWidget *widget, char *data)
+void spawn_cb(GtkWidget *widget, char *data)
 {
-    fork_exec(data);
+    spawn(data);
     gtk_main_quit();
 }
 
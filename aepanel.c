@@ -6,8 +6,6 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <signal.h>
-#include <sys/wait.h>
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xresource.h>
@@ -31,9 +29,9 @@ GdkFilterReturn ev_check(GdkXEvent *, GdkEvent *, gpointer);
 void cli_list_update(GtkWidget *);
 void menu_show_cb(GtkWidget *, gpointer);
 void win_raise_cb(GtkWidget *, Window);
-void fork_exec_cb(GtkWidget *, char *);
+void spawn_cb(GtkWidget *, char *);
+void spawn_done_cb(GPid, gint, gpointer);
 void setup_panel_atoms();
-void sig_handle(int);
 void win_strut_set(Window, int, int, int, int);
 
 Atom net_wm_strut;
@@ -52,7 +50,6 @@ int main(int argc, char **argv)
 {
     GtkWidget *toplevel, *hbox, *launch_menu;
     GtkWidget *clients_box;
-    struct sigaction act;
     char *opt_config = NULL;
     client_t *c;
     int i, rw, rh, h;
@@ -75,10 +72,6 @@ int main(int argc, char **argv)
         }
     }
 
-    act.sa_handler = sig_handle;
-    act.sa_flags = 0;
-    sigaction(SIGCHLD, &act, NULL);
-
     dpy = GDK_DISPLAY();
     root = GDK_ROOT_WINDOW();
 
@@ -163,7 +156,7 @@ void *item_make_cmd_cb(void *menu, char *label, char *cmd)
 
     if (cmd) {
         gtk_signal_connect(GTK_OBJECT(item), "activate",
-            GTK_SIGNAL_FUNC(fork_exec_cb), cmd);
+            GTK_SIGNAL_FUNC(spawn_cb), cmd);
     } else {
         sub_menu = gtk_menu_new();
         gtk_menu_item_set_submenu(GTK_MENU_ITEM(item), sub_menu);
@@ -308,9 +301,21 @@ void win_raise_cb(GtkWidget *widget, Window w)
     win_raise(w);
 }
 
-void fork_exec_cb(GtkWidget *widget, char *data)
+/* GLib reaps the child from the main loop once it exits, so there's no
+ * SIGCHLD handler to worry about. */
+
+void spawn_cb(GtkWidget *widget, char *data)
 {
-    fork_exec(data);
+    pid_t pid;
+
+    if ((pid = spawn(data)) > 0)
+        g_child_watch_add(pid, spawn_done_cb, NULL);
+}
+
+void spawn_done_cb(GPid pid, gint status, gpointer data)
+{
+    g_spawn_close_pid(pid);
+    spawn_stats.reaped++;
 }
 
 void setup_panel_atoms()
@@ -321,12 +326,6 @@ void setup_panel_atoms()
     net_wm_wintype_dock = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DOCK", False);
 }
 
-void sig_handle(int signal)
-{
-    if (signal == SIGCHLD)
-        wait(NULL);
-}
-
 void win_strut_set(Window w, int l, int r, int t, int b)
 {
     unsigned long data[4];
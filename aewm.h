@@ -14,37 +14,59 @@
 #ifdef XFT
 #include <X11/Xft/Xft.h>
 #endif
+#ifdef RENDER
+#include <X11/extensions/Xrender.h>
+#endif
+#ifdef SYNC
+#include <X11/extensions/sync.h>
+#endif
 #include "util.h"
 #include "opts.h"
 
 #ifdef XFT
-#define XFT_USAGE "            [--xftfont|-fa <font>]\n"
+#define XFT_USAGE "            [--xftfont|-fa <font>]\n" \
+                  "            [--sharedraw|-sd]\n"
 #else
 #define XFT_USAGE ""
 #endif
+#ifdef COMPOSITE
+#define COMPOSITE_USAGE "            [--composite|-cm]\n"
+#else
+#define COMPOSITE_USAGE ""
+#endif
 #define USAGE \
     "usage: aewm [--config|-rc <file>]\n" \
     "            [--font|-fn <font>]\n" \
                  XFT_USAGE \
+                 COMPOSITE_USAGE \
     "            [--fgcolor|-fg <color>]\n" \
     "            [--bgcolor|-bg <color>]\n" \
     "            [--bdcolor|-bd <color>]\n" \
     "            [--bdwidth|-bw <pixels>]\n" \
     "            [--padding|-p <pixels>]\n" \
     "            [--maptime|-mt <seconds>]\n" \
+    "            [--titlerate|-tr <hz>]\n" \
+    "            [--hidetime|-ht <seconds>]\n" \
+    "            [--opaque|-op]\n" \
+    "            [--sweeprate|-sr <hz>]\n" \
+    "            [--snap|-sn <pixels>]\n" \
+    "            [--smartplace|-sp]\n" \
+    "            [--layout|-lo <desk> <float|tile|grid>]\n" \
+    "            [--desksize|-ds <width> <height>]\n" \
     "            [--new1|-1 <cmd>]\n" \
     "            [--new2|-2 <cmd>]\n" \
     "            [--new3|-3 <cmd>]\n" \
     "            [--new4|-4 <cmd>]\n" \
     "            [--new5|-5 <cmd>]\n" \
+    "            [--bind|-b <chord> <action>]\n" \
     "            [--help|-h]\n" \
     "            [--version|-v]\n"
 
 #define SUB_MASK (SubstructureRedirectMask|SubstructureNotifyMask)
 #define BTN_MASK (ButtonPressMask|ButtonReleaseMask)
 #define KEY_MASK (KeyPressMask|KeyReleaseMask)
-#define MOUSE_MASK (BTN_MASK|PointerMotionMask|PointerMotionHintMask)
-#define FRAME_MASK (ExposureMask|EnterWindowMask)
+#define MOUSE_MASK (BTN_MASK|PointerMotionMask)
+#define FRAME_MASK (ExposureMask|EnterWindowMask|VisibilityChangeMask)
 
 #ifdef DEBUG
 #define IF_DEBUG(e) e
@@ -52,19 +74,56 @@
 #define IF_DEBUG(e)
 #endif
 
-#define CLI_ON_CUR_DESK(c) ON_DESK((c)->desk, cur_desk)
+#define DIR_LEFT 0
+#define DIR_RIGHT 1
+#define DIR_UP 2
+#define DIR_DOWN 3
+
+/* Where the screen is on c's desk, when desks are bigger than it (see
+ * aewm_view.c). c is on the screen at c->geom minus this. */
+
+#define VIEWING (scr->desk_w > scr->rw || scr->desk_h > scr->rh)
+#define VX(c) view_x((c)->desk)
+#define VY(c) view_y((c)->desk)
+
+/* Most monitors we'll keep track of (see aewm_output.c). */
+
+#define MAX_OUTPUTS 16
+
+#define CLI_ON_CUR_DESK(c) ON_DESK((c)->desk, scr->cur_desk)
 #define FIND_CTX(w, ctx, r) (XFindContext(dpy, w, ctx, (XPointer *)r) == \
     Success)
 #define GRAV(c) ((c->size.flags & PWinGravity) ? c->size.win_gravity : \
     NorthWestGravity)
 
+/*
+ * FIND_TOP looks up the client owning one of the root's children, which is
+ * its frame if it has one and the client window itself if it doesn't (yet,
+ * or any more). TOP is the reverse.
+ */
+
+#define FIND_TOP(w, r) (FIND_CTX(w, frame_tab, r) || FIND_CTX(w, cli_tab, r))
+#define TOP(c) ((c)->frame ? (c)->frame : (c)->win)
+
 /*
  * Accessors for child x/y (relative to frame) and grip height/x/y. The
  * x/y are trivial but if you want to change the child position (e.g. to
  * draw your own frame) it's good to have them abstracted out.
  */
 
-#define IF_D(c, e) ((c)->decor ? e : 0)
+#define DECOR(c) ((c)->decor && !(c)->fullscreen)
+#define IF_D(c, e) (DECOR(c) ? e : 0)
+
+/* Clients without a frame need to tell us about the pointer themselves. */
+
+#define CLI_MASK(c) (DECOR(c) ? PropertyChangeMask : \
+    PropertyChangeMask|EnterWindowMask)
+
+/* The parts of _MOTIF_WM_HINTS we look at: flags, and the decorations the
+ * client wants if the second bit of flags is set. */
+
+#define MWM_HINTS_DECOR (1L << 1)
+#define MWM_NFIELDS 5
 
 #define BW(c) IF_D(c, opt_bw)
 #define CX(c) 0
@@ -91,6 +150,27 @@
 #define DESCENT (font->descent)
 #endif
 
+#ifdef XFT
+#define TITLE_FONT ((XPointer)xftfont)
+#else
+#define TITLE_FONT ((XPointer)font)
+#endif
+
+/* Titles are laid out as glyph indices when we draw them with XRender
+ * (always with Xft, and with core fonts if RENDER is set). With Xft each
+ * glyph also carries the font it came from and its position, since any
+ * one may have come from a fallback font. */
+
+#ifdef XFT
+#define TITLE_GLYPHS
+typedef XftGlyphFontSpec TitleGlyph;
+#else
+#ifdef RENDER
+#define TITLE_GLYPHS
+typedef unsigned int TitleGlyph;
+#endif
+#endif
+
 /*
  * A 'brace' denotes the edges of the usable desk (after accounting for
  * struts. The coordinates are from the origin, so for the trivial case
@@ -103,54 +183,206 @@
 typedef struct { long x; long y; long w; long h; } Geom;
 typedef struct { long l; long r; long t; long b; } Brace;
 
+/*
+ * Everything needed to draw on frames of one visual. Most frames use the
+ * screen's default; a client with a 32-bit ARGB visual gets a frame of
+ * that visual, so the server doesn't have to convert between the two and
+ * the client's alpha channel survives.
+ */
+
 typedef struct {
+    Visual *visual;
+    int depth;
+    Colormap cmap;
+    unsigned long fg;    /* pixel values in this visual */
+    unsigned long bg;
+    unsigned long bd;
+    GC text_gc;
+    GC bord_gc;
+#ifdef XFT
+    XftColor xft_fg;
+    XftDraw *shared_draw; /* for opt_sd, see aewm_title.c */
+#endif
+#ifdef RENDER
+    Picture fg_pict;     /* solid fill to composite title glyphs through */
+#endif
+} Vis;
+
+/*
+ * Everything that's different on each screen of the display. We manage all
+ * of them at once, and scr is the one we're working on: the one the event
+ * we're handling came in on, or the one a timer or startup is going
+ * through. The windows of one screen never turn up on another, so for
+ * anything to do with a client, that's c->scr.
+ */
+
+typedef struct {
+    int num;             /* screen number, for DefaultVisual() and friends */
+    Window root;
+    int rw, rh;          /* its size */
+    Colormap def_cmap;
+    XColor fg;
+    XColor bg;
+    XColor bd;
+    GC inv_gc;           /* for drawing outlines on the root */
+    Vis def_vis;
+    Vis argb_vis;        /* see vis_get */
+    Window *wins;        /* our toplevels, bottom up */
+    unsigned int nwins;
+    Bool wins_stale;     /* wins needs win_list_update */
+    unsigned long ndesks;
+    unsigned long cur_desk;
+    Geom outputs[MAX_OUTPUTS]; /* see aewm_output.c */
+    int noutputs;
+    long strut[12];      /* the root's own, read once at startup */
+    int nstrut;
+    int desk_w, desk_h;  /* see aewm_view.c */
+    struct View *views;
+    int nviews;
+    struct EdgeSet *edge_sets; /* see aewm_snap.c */
+    int nedge_sets;
+    struct Cell *cells;  /* see aewm_grid.c */
+    int gw, gh;
+} ScreenInfo;
+
+/*
+ * What we actually draw in the titlebar. It's laid out from the client's name
+ * for a given font and width, and reused until one of those changes.
+ */
+
+typedef struct {
+    char *name;          /* c->name this was laid out from */
+    XPointer font;       /* font it was measured with */
+    long avail;          /* pixels between the padding and the box */
+#ifdef TITLE_GLYPHS
+    TitleGlyph *glyphs;  /* glyphs to draw, ellipsis included */
+    int len;             /* how many */
+#ifdef XFT
+    int x, y;            /* where the glyph positions are relative to */
+#endif
+#else
+    char *buf;           /* truncated copy with ellipsis, or NULL if it fit */
+    int len;             /* bytes to draw */
+#endif
+} Title;
+
+typedef struct {
+    ScreenInfo *scr;     /* the screen it's on */
     Window win;          /* client's window, our "child" */
     Window trans;        /* if it's transient, some other win, else None */
     Window frame;        /* our win that we reparent it into */
     char *name;          /* WM_NAME */
+    Title title;         /* visible part of name, see aewm_title.c */
     XSizeHints size;     /* WM_NORMAL_HINTS */
     Colormap cmap;       /* WM_COLORMAP */
+    Vis *vis;            /* what we draw the frame with */
     Geom geom;           /* current geometry */
     Geom save;           /* hack to save real geometry if zoomed */
+    Geom fs_save;        /* geometry to go back to after fullscreen */
+    int old_bw;          /* client's own border, for when we let it go */
     unsigned long desk;  /* current EWMH "virtual desktop" */
+    long strut[12];      /* _NET_WM_STRUT(_PARTIAL), see win_strut_get */
+    int nstrut;          /* how many of those it set: 0, 4, or 12 */
 #ifdef XFT
     XftDraw *xftdraw;    /* graphics context for antialiased fonts */
+#endif
+#ifdef RENDER
+    Picture title_pict;  /* frame as a destination for title glyphs */
 #endif
     Bool shaded;         /* user "rolled up", only display grip */
     Bool zoomed;         /* user expanded to full screen */
+    Bool fullscreen;     /* covers the whole screen, with no frame */
     Bool decor;          /* client wants grip and border to be drawn */
+    Bool desktop;        /* it's the desktop, and goes under everything */
     Bool cfg_lock;       /* we don't let the client configure itself yet */
     Bool ign_unmap;      /* we unmapped child, so ignore the next unmap */
+    Bool mapped;         /* we have the child mapped (it isn't hidden) */
+#ifdef SHAPE
+    Bool shaped;         /* child has a bounding shape */
+    Bool shape_ok;       /* frame's shape is up to date with the child's */
+    XRectangle shape_grip; /* grip we last added to the frame's shape */
+#endif
+    int visibility;      /* of the frame, from its last VisibilityNotify */
+    Bool frame_dirty;    /* we skipped a redraw because it was covered */
+    long hidden_at;      /* when we last hid it, in msec */
+    Bool title_due;      /* name changed, but we haven't fetched it yet */
+    long title_at;       /* when we last fetched the name, in msec */
+    unsigned long title_dropped; /* name changes we never got around to */
+    unsigned long seq;   /* order we found it in, for tiling */
+    Bool indexed;        /* its edges are in the snap index... */
+    unsigned long indexed_desk; /* ... under this desk */
+    long indexed_at[4];  /* ... at these: left, right, top, bottom */
+    Bool gridded;        /* it's filed in the grid... */
+    int gx0, gy0, gx1, gy1; /* ... in these cells, inclusive */
+    unsigned int stack;  /* its position in wins, bottom up */
+    Bool loose;          /* it's on the root, on a view's list... */
+    unsigned long loose_desk; /* ... for this desk, see aewm_view.c */
+    unsigned long extents[4]; /* _NET_FRAME_EXTENTS we last set */
+    long sent_x, sent_y; /* root position in our last ConfigureNotify */
 } Client;
 
+/* Counters, dumped to stderr on SIGUSR1. */
+
+typedef struct {
+    unsigned long title_draws;   /* titles actually sent to the server */
+    unsigned long title_dropped; /* name changes superseded by newer ones */
+    unsigned long redraws_skipped;  /* frame redraws while fully covered */
+    unsigned long redraws_deferred; /* ... made up for when uncovered */
+    unsigned long sweep_applied; /* opaque sweep geometries sent */
+    unsigned long sweep_merged;  /* ... superseded before they were sent */
+    unsigned long motion_merged; /* sweep motion events read past unused */
+    unsigned long tiles_moved;   /* clients given a new tile geometry */
+    unsigned long view_pans;     /* times a viewport moved */
+    unsigned long view_notified; /* ConfigureNotifys owed for that, sent */
+    unsigned long bind_actions;  /* bindings done without a new process */
+    unsigned long bind_execs;    /* ... and ones that ran a command */
+#ifdef RANDR
+    unsigned long output_changes; /* RRScreenChangeNotifys handled */
+    unsigned long output_refits;  /* clients moved onto another output */
+#endif
+#ifdef SYNC
+    unsigned long sync_requests; /* resizes we asked a client to confirm */
+    unsigned long sync_timeouts; /* ... and gave up waiting on */
+#endif
+#ifdef COMPOSITE
+    unsigned long comp_frames;   /* repaints of the overlay */
+    unsigned long comp_area;     /* pixels in them, overlaps counted twice */
+#endif
+} Stats;
+
+typedef void TimerFunc(void);
+
 typedef void SweepFunc(Client *, Geom *, Geom *, Brace *, Brace *);
 
 /* aewm_init.c */
-extern Window *wins, pressed, destroying;
+extern ScreenInfo *screens, *scr;
+extern int nscreens;
+extern Window pressed, destroying;
 extern XContext cli_tab, frame_tab;
-extern int rw, rh;
-extern unsigned int nwins;
-extern unsigned long ndesks;
-extern unsigned long cur_desk;
 #ifdef SHAPE
 extern Bool shape;
 extern int shape_event;
 #endif
+#ifdef XI2
+extern Bool xinput;
+extern int xinput_op;
+#endif
+#ifdef SYNC
+extern Bool xsync;
+extern int xsync_event;
+#endif
+#ifdef RANDR
+extern Bool randr;
+extern Bool randr_monitors;
+extern int randr_event;
+#endif
 extern XFontStruct *font;
 #ifdef X_HAVE_UTF8_STRING
 extern XFontSet font_set;
 #endif
 #ifdef XFT
 extern XftFont *xftfont;
-extern XftColor xft_fg;
-#endif
-extern Colormap def_cmap;
-extern XColor fg;
-extern XColor bg;
-extern XColor bd;
-extern GC inv_gc;
-extern GC text_gc;
-extern GC bord_gc;
+#endif
 extern Cursor crs_move;
 extern Cursor crs_size;
 extern Cursor crs_frame;
@@ -166,20 +398,49 @@ extern char *opt_bd;
 extern int opt_bw;
 extern int opt_pad;
 extern int opt_mt;
+extern int opt_tr;
+extern int opt_ht;
+extern Bool opt_op;
+extern int opt_sr;
+extern int opt_sn;
+extern Bool opt_sp;
+extern int opt_dw;
+extern int opt_dh;
+#ifdef XFT
+extern Bool opt_sd;
+#endif
+#ifdef COMPOSITE
+extern Bool opt_cm;
+#endif
+extern Stats stats;
 extern sig_atomic_t timed_out;
 extern sig_atomic_t killed;
+extern sig_atomic_t stats_wanted;
+extern sig_atomic_t children_exited;
 extern int sig_set(int signum, void (*handler)(int));
 extern void sig_handle(int signum);
 extern int err_handle(Display *d, XErrorEvent *e);
+extern ScreenInfo *scr_find(Window w);
 extern void win_list_update(void);
 extern int pointer_get(long *x, long *y);
-extern Brace desk_braces_sum(unsigned long desk);
+extern Brace desk_braces_sum(unsigned long desk, int out);
+extern int win_strut_get(Window w, long *s);
+extern Vis *vis_get(XWindowAttributes *attr);
 /* aewm_client.c */
 extern Client *cli_new(Window w);
 extern void cli_withdraw(Client *c);
 extern void cli_free(Client *c);
 extern void cli_map(Client *c);
 extern void cli_map_apply(Client *c);
+extern void cli_geom_apply(Client *c, Geom old);
+extern void cli_geom_clamp(Client *c, Brace b);
+extern void cli_index(Client *c);
+extern void cli_unindex(Client *c);
+extern void cli_extents_set(Client *c);
+extern void win_extents_set(Window w);
+extern void cli_reparent(Client *c);
+extern void cli_unreparent(Client *c);
+extern void cli_frames_reap(void);
 extern int cli_state_set(Client *c, unsigned long state);
 extern void cli_state_apply(Client *c);
 extern void cli_send_cfg(Client *c);
@@ -188,9 +449,32 @@ extern Geom cli_frame_geom(Client *c, Geom f);
 #ifdef SHAPE
 extern void cli_shape_set(Client *c);
 #endif
+/* aewm_title.c */
+extern void title_draw(Client *c, int x, int y, long avail);
+extern void title_clear(Client *c);
+extern void title_update(Client *c);
+extern void title_surface_free(Client *c);
+#ifdef XFT
+extern void title_fonts_free(void);
+#endif
 /* aewm_event.c */
 extern Bool event_get_next(long mask, XEvent *ev);
 extern void ev_loop(void);
+extern void ev_dispatch(XEvent *ev);
+extern void desk_switch_to(int new_desk);
+extern void timer_set(TimerFunc *fn, long msec);
+extern void timer_clear(TimerFunc *fn);
+extern void stats_print(void);
+#ifdef COMPOSITE
+/* aewm_comp.c */
+extern void comp_init(void);
+extern void comp_free(void);
+extern void comp_event(XEvent *e);
+extern void comp_paint(void);
+extern Window comp_overlay(ScreenInfo *s);
+extern void comp_resize(ScreenInfo *s);
+extern void comp_stats_print(void);
+#endif
 #ifdef DEBUG
 extern void ev_print(XEvent e);
 extern const char *cli_grav_str(Client *c);
@@ -202,6 +486,7 @@ extern void cli_list(void);
 /* aewm_manip.c */
 extern void cli_pressed(Client *c, int x, int y, int button);
 extern void cli_raise(Client *c);
+extern void cli_restack(Client *c);
 extern void cli_lower(Client *c);
 extern void cli_show(Client *c);
 extern void cli_hide(Client *c);
@@ -212,10 +497,68 @@ extern void cli_set_iconified(Client *c, long state);
 extern void cli_shade(Client *c);
 extern void cli_unshade(Client *c);
 extern void cli_grow(Client *c);
+extern void cli_zoom_geom(Client *c, int out);
 extern void cli_shrink(Client *c);
+extern void cli_fullscreen(Client *c);
+extern void cli_unfullscreen(Client *c);
 extern void cli_req_close(Client *c);
 extern void cli_sweep(Client *c, Cursor curs, SweepFunc cb);
+extern void cli_moveresize(Client *c, long dir, long button);
+#ifdef SYNC
+extern void cli_sync_alarm(XSyncAlarmNotifyEvent *e);
+#endif
 extern void calc_move(Client *c, Geom *orig, Geom *m, Brace *b, Brace *h);
 extern void calc_resize(Client *c, Geom *orig, Geom *m, Brace *b, Brace *h);
 extern Geom cli_geom_fixup(Client *c);
+/* aewm_snap.c */
+extern void snap_index(Client *c);
+extern void snap_remove(Client *c);
+extern void snap_move(Client *c, Brace *b);
+extern void snap_free(void);
+/* aewm_grid.c */
+extern void grid_index(Client *c);
+extern void grid_remove(Client *c);
+extern Client *grid_at(long x, long y);
+extern Client *grid_neighbor(Client *from, long x, long y, int dir);
+extern void grid_each(long x0, long y0, long x1, long y1,
+    void (*fn)(Client *));
+extern void grid_free(void);
+/* aewm_tile.c */
+extern void tile_layout_set(unsigned long desk, char *name);
+extern Bool tile_owns(Client *c);
+extern void tile_dirty(unsigned long desk);
+extern void tile_free(void);
+/* aewm_view.c */
+extern void view_init(void);
+extern long view_x(unsigned long desk);
+extern long view_y(unsigned long desk);
+extern Window view_parent(Client *c);
+extern Window view_floor(Client *c);
+extern void view_track(Client *c);
+extern void view_untrack(Client *c);
+extern Bool view_is_box(Window w);
+extern void view_offset(Client *c, long *x, long *y);
+extern Geom view_frame_geom(Client *c);
+extern void view_desk_set(Client *c, unsigned long desk);
+extern void view_pan(unsigned long desk, long x, long y);
+extern void view_show(Client *c);
+extern void view_desk_switch(unsigned long from);
+extern void view_notify(Client *c);
+extern void view_resize(void);
+extern void view_free(void);
+/* aewm_output.c */
+extern void output_init(void);
+extern int output_at(long x, long y);
+extern int output_of(Client *c);
+extern int output_pointer(void);
+#ifdef RANDR
+extern void output_changed(XEvent *e);
+#endif
+/* aewm_bind.c */
+extern void bind_set(char *chord, char *action);
+extern void bind_init(void);
+extern void keys_grab(void);
+extern void bind_button(XButtonEvent *e);
+extern void bind_key(XKeyEvent *e);
+extern void bind_free(void);
 #endif /* AEWM_WM_H */
@@ -0,0 +1,362 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <X11/keysym.h>
+#include "aewm.h"
+
+/*
+ * What clicking on the root and the keys we grab there do. Each binding is
+ * a chord -- some modifiers and either a button or a key -- and an action.
+ * Most actions are done right here, so a turn of the mouse wheel over the
+ * root is a desk switch and nothing more; only "exec" starts a program.
+ *
+ *  - exec <command>: run it (see spawn). The rest of the line is the
+ *    command, unless it's in quotes.
+ *  - desk <+n|-n>: go that many desks over, wrapping around.
+ *  - cycle [-1]: raise and focus the lowest window on this desk, or with
+ *    -1, lower the highest and focus the one under it.
+ *  - raise, lower, iconify, close: do that to the window under the pointer.
+ *  - focus <dir>: raise and focus the nearest window in that direction
+ *    from the one under the pointer.
+ *  - pan <dir>: on a desk bigger than the screen, scroll half a screen.
+ *
+ * For focus and cycle, the pointer is moved into the window as well, so
+ * that focus stays put, and on a desk bigger than the screen, we pan over
+ * to it. None of it has to ask the server anything: the event says where
+ * the pointer is, and the grid knows what's there.
+ *
+ * Bindings given with "bind" in the rc file or --bind come first, then
+ * the --newN commands for the buttons, then the defaults in def_binds.
+ * Only the first binding for each chord counts. Lock and NumLock are
+ * ignored.
+ */
+
+#define BIND_MODS (ShiftMask|ControlMask|Mod1Mask|Mod3Mask|Mod4Mask|Mod5Mask)
+
+#define ACT_EXEC 0
+#define ACT_DESK 1
+#define ACT_CYCLE 2
+#define ACT_RAISE 3
+#define ACT_LOWER 4
+#define ACT_ICONIFY 5
+#define ACT_CLOSE 6
+#define ACT_FOCUS 7
+#define ACT_PAN 8
+
+typedef struct {
+    unsigned int mods;
+    unsigned int button; /* 0 for a key */
+    KeySym sym;
+    KeyCode code;        /* looked up when we grab it */
+    int action;
+    long arg;
+    char *cmd;           /* for ACT_EXEC */
+} Binding;
+
+static Binding def_binds[] = {
+    { 0, Button4, NoSymbol, 0, ACT_DESK, -1, NULL },
+    { 0, Button5, NoSymbol, 0, ACT_DESK, 1, NULL },
+    { Mod4Mask, 0, XK_Left, 0, ACT_FOCUS, DIR_LEFT, NULL },
+    { Mod4Mask, 0, XK_Right, 0, ACT_FOCUS, DIR_RIGHT, NULL },
+    { Mod4Mask, 0, XK_Up, 0, ACT_FOCUS, DIR_UP, NULL },
+    { Mod4Mask, 0, XK_Down, 0, ACT_FOCUS, DIR_DOWN, NULL },
+    { Mod4Mask|ShiftMask, 0, XK_Left, 0, ACT_PAN, DIR_LEFT, NULL },
+    { Mod4Mask|ShiftMask, 0, XK_Right, 0, ACT_PAN, DIR_RIGHT, NULL },
+    { Mod4Mask|ShiftMask, 0, XK_Up, 0, ACT_PAN, DIR_UP, NULL },
+    { Mod4Mask|ShiftMask, 0, XK_Down, 0, ACT_PAN, DIR_DOWN, NULL },
+    { Mod4Mask, 0, XK_Tab, 0, ACT_CYCLE, 1, NULL },
+    { Mod4Mask|ShiftMask, 0, XK_Tab, 0, ACT_CYCLE, -1, NULL },
+    { Mod4Mask, 0, XK_Prior, 0, ACT_DESK, -1, NULL },
+    { Mod4Mask, 0, XK_Next, 0, ACT_DESK, 1, NULL },
+};
+
+static char *act_names[] = {
+    "exec", "desk", "cycle", "raise", "lower", "iconify", "close", "focus",
+    "pan",
+};
+
+static char *dir_names[] = { "left", "right", "up", "down" };
+
+static Binding *bind_find(unsigned int mods, unsigned int button,
+    KeySym sym, KeyCode code);
+static Binding *bind_add(Binding *b);
+static Bool chord_parse(char *chord, Binding *b);
+static void bind_run(Binding *b, long x, long y);
+static void act_cycle(long dir);
+static void act_go(Client *c);
+
+static Binding *binds;
+static int nbinds;
+
+/* Called for each --bind or "bind" line. */
+
+void bind_set(char *chord, char *action)
+{
+    char name[BUF_SIZE], arg[BUF_SIZE];
+    Binding b, *old;
+    size_t i;
+
+    if (!chord_parse(chord, &b)) {
+        fprintf(stderr, "aewm: unknown key or button '%s'\n", chord);
+        return;
+    }
+    if (!tok_next(&action, name)) {
+        fprintf(stderr, "aewm: no action for '%s'\n", chord);
+        return;
+    }
+    for (b.action = 0; b.action < sizeof act_names / sizeof *act_names;
+            b.action++)
+        if (strcmp(name, act_names[b.action]) == 0) break;
+    if (b.action == sizeof act_names / sizeof *act_names) {
+        fprintf(stderr, "aewm: unknown action '%s'\n", name);
+        return;
+    }
+
+    b.arg = b.action == ACT_CYCLE ? 1 : 0;
+    b.cmd = NULL;
+    if (b.action == ACT_EXEC) {
+        while (isspace(*action)) action++;
+        if (*action == '"') {
+            tok_next(&action, arg);
+            b.cmd = strdup(arg);
+        } else {
+            b.cmd = strdup(action);
+            for (i = strlen(b.cmd); i > 0 && isspace(b.cmd[i - 1]); i--)
+                b.cmd[i - 1] = '\0';
+        }
+    } else if (tok_next(&action, arg)) {
+        if (b.action == ACT_FOCUS || b.action == ACT_PAN) {
+            for (b.arg = 0; b.arg < 4; b.arg++)
+                if (strcmp(arg, dir_names[b.arg]) == 0) break;
+            if (b.arg == 4) {
+                fprintf(stderr, "aewm: unknown direction '%s'\n", arg);
+                return;
+            }
+        } else {
+            b.arg = atol(arg);
+        }
+    }
+
+    if ((old = bind_find(b.mods, b.button, b.sym, 0))) {
+        free(old->cmd);
+        *old = b;
+    } else {
+        bind_add(&b);
+    }
+}
+
+/* Fill in whatever hasn't been bound yet. */
+
+void bind_init(void)
+{
+    Binding b;
+    unsigned int i;
+
+    for (i = 0; i < 5; i++) {
+        if (opt_new[i] && !bind_find(0, Button1 + i, NoSymbol, 0)) {
+            memset(&b, 0, sizeof b);
+            b.button = Button1 + i;
+            b.action = ACT_EXEC;
+            b.cmd = strdup(opt_new[i]);
+            bind_add(&b);
+        }
+    }
+    for (i = 0; i < sizeof def_binds / sizeof *def_binds; i++)
+        if (!bind_find(def_binds[i].mods, def_binds[i].button,
+                def_binds[i].sym, 0))
+            bind_add(&def_binds[i]);
+}
+
+/* Grab every key binding on scr's root. There's no point in the panning
+ * ones unless its desks are bigger than it. */
+
+void keys_grab(void)
+{
+    unsigned int locks[] = { 0, LockMask, Mod2Mask, LockMask|Mod2Mask };
+    unsigned int j;
+    int i;
+
+    for (i = 0; i < nbinds; i++) {
+        if (binds[i].button || (binds[i].action == ACT_PAN && !VIEWING))
+            continue;
+        if (!binds[i].code)
+            binds[i].code = XKeysymToKeycode(dpy, binds[i].sym);
+        if (!binds[i].code)
+            continue;
+        for (j = 0; j < sizeof locks / sizeof *locks; j++)
+            XGrabKey(dpy, binds[i].code, binds[i].mods|locks[j], scr->root,
+                True, GrabModeAsync, GrabModeAsync);
+    }
+}
+
+void bind_button(XButtonEvent *e)
+{
+    Binding *b;
+
+    if ((b = bind_find(e->state & BIND_MODS, e->button, NoSymbol, 0)))
+        bind_run(b, e->x_root, e->y_root);
+}
+
+void bind_key(XKeyEvent *e)
+{
+    Binding *b;
+
+    if ((b = bind_find(e->state & BIND_MODS, 0, NoSymbol, e->keycode)))
+        bind_run(b, e->x_root, e->y_root);
+}
+
+void bind_free(void)
+{
+    int i;
+
+    for (i = 0; i < nbinds; i++)
+        free(binds[i].cmd);
+    free(binds);
+    binds = NULL;
+    nbinds = 0;
+}
+
+/* Keys are matched by sym until they've been grabbed, and by code after. */
+
+static Binding *bind_find(unsigned int mods, unsigned int button,
+    KeySym sym, KeyCode code)
+{
+    int i;
+
+    for (i = 0; i < nbinds; i++)
+        if (binds[i].mods == mods && binds[i].button == button &&
+                (code ? binds[i].code == code : binds[i].sym == sym))
+            return &binds[i];
+    return NULL;
+}
+
+static Binding *bind_add(Binding *b)
+{
+    binds = realloc(binds, (nbinds + 1) * sizeof *binds);
+    binds[nbinds] = *b;
+    return &binds[nbinds++];
+}
+
+/* Modifiers and then a button or key, joined by "+": "Button4",
+ * "Mod4+Shift+Left". */
+
+static Bool chord_parse(char *chord, Binding *b)
+{
+    static struct { char *name; unsigned int mask; } mod_names[] = {
+        { "Shift", ShiftMask }, { "Control", ControlMask },
+        { "Ctrl", ControlMask }, { "Mod1", Mod1Mask }, { "Alt", Mod1Mask },
+        { "Mod3", Mod3Mask }, { "Mod4", Mod4Mask }, { "Super", Mod4Mask },
+        { "Mod5", Mod5Mask },
+    };
+    char buf[BUF_SIZE], *part = buf, *plus;
+    unsigned int i;
+
+    memset(b, 0, sizeof *b);
+    strncpy(buf, chord, sizeof buf - 1);
+    buf[sizeof buf - 1] = '\0';
+
+    while ((plus = strchr(part, '+')) && plus[1]) {
+        *plus = '\0';
+        for (i = 0; i < sizeof mod_names / sizeof *mod_names; i++)
+            if (strcmp(part, mod_names[i].name) == 0) break;
+        if (i == sizeof mod_names / sizeof *mod_names)
+            return False;
+        b->mods |= mod_names[i].mask;
+        part = plus + 1;
+    }
+
+    if (strncmp(part, "Button", 6) == 0 && part[6] >= '1' &&
+            part[6] <= '5' && !part[7])
+        b->button = Button1 + part[6] - '1';
+    else if ((b->sym = XStringToKeysym(part)) == NoSymbol)
+        return False;
+    return True;
+}
+
+static void bind_run(Binding *b, long x, long y)
+{
+    long vx = view_x(scr->cur_desk), vy = view_y(scr->cur_desk), d;
+    Client *c;
+
+    if (b->action == ACT_EXEC) {
+        spawn(b->cmd);
+        stats.bind_execs++;
+        return;
+    }
+
+    stats.bind_actions++;
+    switch (b->action) {
+        case ACT_DESK:
+            d = ((long)scr->cur_desk + b->arg) % (long)scr->ndesks;
+            desk_switch_to(d < 0 ? d + scr->ndesks : d);
+            break;
+        case ACT_CYCLE:
+            act_cycle(b->arg);
+            break;
+        case ACT_FOCUS:
+            if ((c = grid_neighbor(grid_at(x + vx, y + vy), x + vx, y + vy,
+                    b->arg)))
+                act_go(c);
+            break;
+        case ACT_PAN:
+            view_pan(scr->cur_desk,
+                vx + (b->arg == DIR_LEFT ? -scr->rw : b->arg == DIR_RIGHT ?
+                    scr->rw : 0) / 2,
+                vy + (b->arg == DIR_UP ? -scr->rh : b->arg == DIR_DOWN ?
+                    scr->rh : 0) / 2);
+            break;
+        default:
+            if (!(c = grid_at(x + vx, y + vy)))
+                break;
+            switch (b->action) {
+                case ACT_RAISE: cli_raise(c); break;
+                case ACT_LOWER: cli_lower(c); break;
+                case ACT_ICONIFY: cli_set_iconified(c, IconicState); break;
+                case ACT_CLOSE: cli_req_close(c); break;
+            }
+            break;
+    }
+}
+
+/* Going up, the lowest window comes to the top; going down, the highest
+ * goes to the bottom. Either way, each one gets a turn. */
+
+static void act_cycle(long dir)
+{
+    Client *c, *low = NULL, *high = NULL, *next = NULL;
+    unsigned int i;
+
+    for (i = 0; i < scr->nwins; i++) {
+        if (FIND_TOP(scr->wins[i], &c) && c->frame && c->mapped &&
+                CLI_ON_CUR_DESK(c)) {
+            if (!low) low = c;
+            next = high;
+            high = c;
+        }
+    }
+
+    if (dir >= 0 && low) {
+        act_go(low);
+    } else if (dir < 0 && next) {
+        cli_lower(high);
+        act_go(next);
+    }
+}
+
+static void act_go(Client *c)
+{
+    Geom f;
+
+    view_show(c);
+    cli_raise(c);
+    cli_focus(c);
+    f = view_frame_geom(c);
+    XWarpPointer(dpy, None, scr->root, 0, 0, 0, 0,
+        (L(f, c) + R(f, c)) / 2 - view_x(scr->cur_desk),
+        (T(f, c) + B(f, c)) / 2 - view_y(scr->cur_desk));
+}
@@ -13,7 +13,13 @@
 #include "aewm.h"
 
 static Bool cli_geom_init(Client *);
-static void cli_reparent(Client *);
+static void cli_place(Client *, Brace);
+static Bool win_wants_decor(Window);
+static void frame_extents(Client *, unsigned long *);
+
+static unsigned long cli_seq;
+
+#define PLACE_CELL 16
 
 /* Set up a client structure for the new (not-yet-mapped) window. */
 
@@ -22,23 +28,43 @@ Client *cli_new(Window w)
     Client *c;
     XWindowAttributes attr;
     long supplied;
-    Atom win_type;
+    Atom type;
 
     c = malloc(sizeof *c);
     XSaveContext(dpy, w, cli_tab, (XPointer)c);
 
+    c->scr = scr;
     c->win = w;
     c->frame = c->trans = None;
     c->name = NULL;
-    c->desk = cur_desk;
+#ifdef TITLE_GLYPHS
+    c->title.glyphs = NULL;
+#else
+    c->title.buf = NULL;
+#endif
+    title_clear(c);
+    c->desk = scr->cur_desk;
+    c->seq = ++cli_seq;
+    c->indexed = False;
+    c->gridded = False;
+    c->stack = 0;
 #ifdef XFT
     c->xftdraw = NULL;
+#endif
+#ifdef RENDER
+    c->title_pict = None;
 #endif
     c->shaded = False;
     c->zoomed = False;
-    c->decor = True;
+    c->fullscreen = False;
     c->cfg_lock = True;
     c->ign_unmap = False;
+    c->visibility = VisibilityUnobscured;
+    c->frame_dirty = False;
+    c->hidden_at = 0;
+    c->title_due = False;
+    c->title_at = 0;
+    c->title_dropped = 0;
 
     XGetTransientForHint(dpy, c->win, &c->trans);
     c->size.flags = 0;
@@ -49,21 +75,40 @@ Client *cli_new(Window w)
     c->geom.y = attr.y;
     c->geom.w = attr.width;
     c->geom.h = attr.height;
+    c->old_bw = attr.border_width;
     c->cmap = attr.colormap;
+    c->vis = vis_get(&attr);
+    c->mapped = attr.map_state == IsViewable;
+    c->nstrut = win_strut_get(c->win, c->strut);
+#ifdef SHAPE
+    c->shaped = False;
+    c->shape_ok = False;
+#endif
 
-    if (atom_get(c->win, net_wm_wintype, XA_ATOM, 0, &win_type, 1, NULL) && (
-            win_type == net_wm_type_desk || win_type == net_wm_type_dock ||
-            win_type == net_wm_type_menu || win_type == net_wm_type_splash)) {
-        c->decor = False;
-    }
+    c->decor = win_wants_decor(c->win);
+    c->desktop = atom_get(c->win, net_wm_wintype, XA_ATOM, 0, &type, 1,
+        NULL) && type == net_wm_type_desk;
+
+    /* Undecorated clients are never framed, so there's no Expose to wait
+     * for before letting them place themselves. */
+    if (!c->decor)
+        c->cfg_lock = False;
 
     if (!atom_get(c->win, net_wm_desk, XA_CARDINAL, 0, &c->desk, 1, NULL) ||
-            !(c->desk >= ndesks && c->desk != DESK_ALL)) {
-        atom_set(c->win, net_wm_desk, XA_CARDINAL, &cur_desk, 1);
-        c->desk = cur_desk;
+            !(c->desk >= scr->ndesks && c->desk != DESK_ALL)) {
+        atom_set(c->win, net_wm_desk, XA_CARDINAL, &scr->cur_desk, 1);
+        c->desk = scr->cur_desk;
     }
+    c->sent_x = c->geom.x;
+    c->sent_y = c->geom.y;
+    c->geom.x += VX(c);
+    c->geom.y += VY(c);
+    c->loose = False;
+    view_track(c);
 
     c->name = win_name_get(c->win);
+    frame_extents(c, c->extents);
+    atom_set(c->win, net_frame_extents, XA_CARDINAL, c->extents, 4);
     return c;
 }
 
@@ -79,34 +124,53 @@ void cli_free(Client *c)
 {
     destroying = c->win;
 
-    XSetWindowBorderWidth(dpy, c->win, 1);
-    XReparentWindow(dpy, c->win, root, c->geom.x, c->geom.y);
-    XRemoveFromSaveSet(dpy, c->win);
-#ifdef XFT
-    if (c->xftdraw) XftDrawDestroy(c->xftdraw);
-#endif
-    XDestroyWindow(dpy, c->frame);
+    if (c->frame)
+        cli_unreparent(c);
+    else if (c->fullscreen)
+        XSetWindowBorderWidth(dpy, c->win, c->old_bw);
+    view_untrack(c);
 
-    atom_del(root, net_client_list, XA_WINDOW, c->win);
+    atom_del(scr->root, net_client_list, XA_WINDOW, c->win);
     XDeleteContext(dpy, c->win, cli_tab);
-    XDeleteContext(dpy, c->frame, frame_tab);
+    cli_unindex(c);
+    if (c->mapped)
+        tile_dirty(c->desk);
 
+    title_clear(c);
     if (c->name) XFree(c->name);
     free(c);
 }
 
+/* We don't reparent here; the frame is made the first time the client is
+ * actually shown (see cli_reparent). What we do need right away is to hear
+ * about property changes, which might concern a client we haven't shown. */
+
 void cli_map(Client *c)
 {
-    XWindowAttributes attr;
+    XSetWindowAttributes cattr;
     XWMHints *hints;
+#ifdef SHAPE
+    int xb, yb, xc, yc;
+    unsigned int wb, hb, wc, hc;
+    Bool clip_shaped;
+#endif
+
+    cattr.cursor = crs_win;
+    XChangeWindowAttributes(dpy, c->win, CWCursor, &cattr);
+    XSelectInput(dpy, c->win, CLI_MASK(c));
+#ifdef SHAPE
+    if (shape) {
+        XShapeSelectInput(dpy, c->win, ShapeNotifyMask);
+        XShapeQueryExtents(dpy, c->win, &c->shaped, &xb, &yb, &wb, &hb,
+            &clip_shaped, &xc, &yc, &wc, &hc);
+    }
+#endif
 
     cli_state_apply(c);
-    XGetWindowAttributes(dpy, c->win, &attr);
 
-    if (attr.map_state == IsViewable) {
+    if (c->mapped) {
         if (win_state_get(c->win) == WithdrawnState)
             cli_state_set(c, NormalState);
-        cli_reparent(c);
     } else {
         cli_state_set(c, NormalState);
         if ((hints = XGetWMHints(dpy, c->win))) {
@@ -114,7 +178,6 @@ void cli_map(Client *c)
                 cli_state_set(c, hints->initial_state);
             XFree(hints);
         }
-        cli_reparent(c);
         if (!cli_geom_init(c) && opt_mt) {
             if (opt_mt > 0) {
                 sig_set(SIGALRM, sig_handle);
@@ -122,11 +185,12 @@ void cli_map(Client *c)
             }
             cli_sweep(c, crs_move, calc_move);
         }
+        cli_restack(c);
     }
 
     IF_DEBUG(cli_print(c, "<map>"));
     cli_map_apply(c);
-    atom_add(root, net_client_list, XA_WINDOW, &c->win, 1);
+    atom_add(scr->root, net_client_list, XA_WINDOW, &c->win, 1);
 }
 
 /* When we're ready to map, we have two things to consider: the literal
@@ -140,24 +204,15 @@ void cli_map(Client *c)
 
 static Bool cli_geom_init(Client *c)
 {
-    Atom state;
-    long px, py;
-    Brace b = desk_braces_sum(c->desk);
-    Geom f;
+    long px, py, vx = VX(c), vy = VY(c);
+    Client *p;
+    Bool placed = False;
 
     /* We decide the geometry for these types of windows, so we can just
-     * ignore everything and return right away. If c->zoomed is set, that
-     * means we've already set things up, but otherwise, we do it here. */
-    if (c->zoomed)
-        return True;
-    if (atom_get(c->win, net_wm_state, XA_ATOM, 0, &state, 1, NULL) &&
-            state == net_wm_state_fs) {
-        c->geom.x = 0;
-        c->geom.y = 0;
-        c->geom.w = rw;
-        c->geom.h = rh;
+     * ignore everything and return right away. If c->zoomed or
+     * c->fullscreen is set, cli_state_apply has already set things up. */
+    if (c->zoomed || c->fullscreen)
         return True;
-    }
 
     /* Here, we merely set the values; they're in the same place regardless
      * of whether the user or the program specified them. We'll distinguish
@@ -167,8 +222,8 @@ static Bool cli_geom_init(Client *c)
         if (c->size.height > 0) c->geom.h = c->size.height;
     }
     if (c->size.flags & (USPosition|PPosition)) {
-        if (c->size.x > 0) c->geom.x = c->size.x;
-        if (c->size.y > 0) c->geom.y = c->size.y;
+        if (c->size.x > 0) c->geom.x = c->size.x + vx;
+        if (c->size.y > 0) c->geom.y = c->size.y + vy;
     }
 
     /* No need to go further if it's not decorated */
@@ -177,79 +232,249 @@ static Bool cli_geom_init(Client *c)
         return True;
 
     /* At this point, maybe nothing was set, or something went horribly wrong
-     * and the values are garbage. So, try to center it on the pointer. */
+     * and the values are garbage. A transient goes over the middle of its
+     * owner, if we know where that is. Otherwise, with opt_sp we look for
+     * the emptiest spot on the pointer's output, or else try to center it
+     * on the pointer. */
     cli_geom_fixup(c);
-    pointer_get(&px, &py);
-    if (c->geom.x <= 0) c->geom.x = px - c->geom.w / 2;
-    if (c->geom.y <= 0) c->geom.y = py - c->geom.h / 2;
+    if (c->geom.x <= vx || c->geom.y <= vy) {
+        if (c->trans && FIND_CTX(c->trans, cli_tab, &p)) {
+            if (c->geom.x <= vx)
+                c->geom.x = p->geom.x - VX(p) + vx +
+                    (p->geom.w - c->geom.w) / 2;
+            if (c->geom.y <= vy)
+                c->geom.y = p->geom.y - VY(p) + vy +
+                    (p->geom.h - c->geom.h) / 2;
+        } else if (opt_sp && c->geom.x <= vx && c->geom.y <= vy) {
+            cli_place(c, desk_braces_sum(c->desk, output_pointer()));
+            placed = True;
+        } else {
+            pointer_get(&px, &py);
+            if (c->geom.x <= vx) c->geom.x = px + vx - c->geom.w / 2;
+            if (c->geom.y <= vy) c->geom.y = py + vy - c->geom.h / 2;
+        }
+    }
 
     /* In any case, if we got this far, we need to do a further sanity check
-     * and make sure that the window isn't overlapping any braces. */
-    f = cli_frame_geom(c, c->geom);
+     * and make sure that the window isn't overlapping any braces of the
+     * output it ended up on. */
+    cli_geom_clamp(c, desk_braces_sum(c->desk, output_of(c)));
+
+    /* Finally, we decide if we were ultimately satisfied with the position
+     * given, or if we had to make something up, so that the caller can
+     * consider using some other method. */
+    return c->trans || placed || c->size.flags & USPosition;
+}
+
+/* Move c so that its frame is inside b, or at least its top left corner
+ * is, if it's too big. */
+
+void cli_geom_clamp(Client *c, Brace b)
+{
+    Geom f = cli_frame_geom(c, c->geom);
+
     if (R(f, c) > b.r) c->geom.x -= R(f, c) - b.r;
     if (B(f, c) > b.b) c->geom.y -= B(f, c) - b.b;
     f = cli_frame_geom(c, c->geom);
     if (L(f, c) < b.l) c->geom.x += b.l - L(f, c);
     if (T(f, c) < b.t) c->geom.y += b.t - T(f, c);
+}
 
-    /* Finally, we decide if we were ultimately satisfied with the position
-     * given, or if we had to make something up, so that the caller can
-     * consider using some other method. */
-    return c->trans || c->size.flags & USPosition;
+/*
+ * Find the spot inside the braces where the new frame would cover the
+ * least of the other frames on its desk. We chop the area up into cells
+ * PLACE_CELL pixels on a side, count how many frames cover each cell, and
+ * then turn those counts into a summed-area table, so that the overlap for
+ * any position is four lookups. Everything comes from the geometry we
+ * already have, so there's no talking to the server. Ties go to the
+ * topmost, then leftmost position.
+ */
+
+static void cli_place(Client *c, Brace b)
+{
+    Geom f = cli_frame_geom(c, c->geom), g;
+    long gw = (b.r - b.l) / PLACE_CELL, gh = (b.b - b.t) / PLACE_CELL;
+    long ww = (R(f, c) - L(f, c) + PLACE_CELL - 1) / PLACE_CELL;
+    long wh = (B(f, c) - T(f, c) + PLACE_CELL - 1) / PLACE_CELL;
+    long x0, y0, x1, y1, x, y, n, best = -1, bx = 0, by = 0, *sat;
+    unsigned int i;
+    Client *o;
+
+    if (ww > gw || wh > gh || !(sat = calloc((gw + 1) * (gh + 1),
+            sizeof *sat))) {
+        c->geom.x += b.l - L(f, c);
+        c->geom.y += b.t - T(f, c);
+        return;
+    }
+#define SAT(x, y) sat[(y) * (gw + 1) + (x)]
+
+    /* Mark each frame's corners, so that summing twice over gives first
+     * the coverage of each cell and then the table. */
+    for (i = 0; i < scr->nwins; i++) {
+        if (FIND_TOP(scr->wins[i], &o) && o != c && o->mapped &&
+                ON_DESK(o->desk, c->desk)) {
+            g = cli_frame_geom(o, o->geom);
+            g.x += VX(c) - VX(o);
+            g.y += VY(c) - VY(o);
+            x0 = (L(g, o) - b.l) / PLACE_CELL;
+            y0 = (T(g, o) - b.t) / PLACE_CELL;
+            x1 = (R(g, o) - b.l + PLACE_CELL - 1) / PLACE_CELL;
+            y1 = (B(g, o) - b.t + PLACE_CELL - 1) / PLACE_CELL;
+            if (x0 < 0) x0 = 0;
+            if (y0 < 0) y0 = 0;
+            if (x1 > gw) x1 = gw;
+            if (y1 > gh) y1 = gh;
+            if (x0 >= x1 || y0 >= y1)
+                continue;
+            SAT(x0 + 1, y0 + 1)++;
+            if (x1 < gw) SAT(x1 + 1, y0 + 1)--;
+            if (y1 < gh) SAT(x0 + 1, y1 + 1)--;
+            if (x1 < gw && y1 < gh) SAT(x1 + 1, y1 + 1)++;
+        }
+    }
+    for (n = 0; n < 2; n++)
+        for (y = 1; y <= gh; y++)
+            for (x = 1; x <= gw; x++)
+                SAT(x, y) += SAT(x - 1, y) + SAT(x, y - 1) - SAT(x - 1, y - 1);
+
+    for (y = 0; y + wh <= gh && best; y++) {
+        for (x = 0; x + ww <= gw && best; x++) {
+            n = SAT(x + ww, y + wh) - SAT(x, y + wh) - SAT(x + ww, y)
+                + SAT(x, y);
+            if (best < 0 || n < best) {
+                best = n;
+                bx = x;
+                by = y;
+            }
+        }
+    }
+#undef SAT
+    free(sat);
+
+    c->geom.x += b.l + bx * PLACE_CELL - L(f, c);
+    c->geom.y += b.t + by * PLACE_CELL - T(f, c);
 }
 
-/* The frame window is not created until we actually do the reparenting here,
- * and thus the Xft surface cannot exist until this runs. Anything that has to
- * manipulate the client before we are called must make sure not to attempt to
- * use either. */
+/*
+ * The frame window is not created until the client is first shown, and
+ * thus the Xft surface cannot exist until then either. Clients on other
+ * desks or iconified at startup may never need one, and undecorated ones
+ * (docks, splash screens and so on) never get one at all. Until then the
+ * client window stays where it was, a child of the root, and anything that
+ * touches c->frame must check that it's there.
+ *
+ * The frame goes right above the client window in the stacking order, so
+ * that frames built for a whole desk at once keep the order the clients
+ * were in. On a desk with a viewport, it goes in the desk's box instead.
+ */
 
-static void cli_reparent(Client *c)
+void cli_reparent(Client *c)
 {
-    XSetWindowAttributes pattr, cattr;
+    XSetWindowAttributes pattr;
+    XWindowChanges wc;
     Geom f = cli_frame_geom(c, c->geom);
+    Window parent = view_parent(c);
 
     pattr.override_redirect = True;
-    pattr.background_pixel = bg.pixel;
-    pattr.border_pixel = bd.pixel;
+    pattr.background_pixel = c->vis->bg;
+    pattr.border_pixel = c->vis->bd;
+    pattr.colormap = c->vis->cmap;
     pattr.event_mask = SUB_MASK|BTN_MASK|FRAME_MASK;
     pattr.cursor = crs_frame;
-    c->frame = XCreateWindow(dpy, root, 0, 0, f.w, f.h, BW(c),
-        DefaultDepth(dpy, screen), CopyFromParent, DefaultVisual(dpy, screen),
-        CWOverrideRedirect|CWBackPixel|CWBorderPixel|CWEventMask|CWCursor,
-        &pattr);
-
-    cattr.cursor = crs_win;
-    XChangeWindowAttributes(dpy, c->win, CWCursor, &cattr);
-
-#ifdef SHAPE
-    if (shape) {
-        XShapeSelectInput(dpy, c->win, ShapeNotifyMask);
-        cli_shape_set(c);
+    c->frame = XCreateWindow(dpy, parent, f.x, f.y, f.w, f.h, BW(c),
+        c->vis->depth, InputOutput, c->vis->visual,
+        CWOverrideRedirect|CWBackPixel|CWBorderPixel|CWColormap|
+        CWEventMask|CWCursor, &pattr);
+    if (parent == scr->root) {
+        wc.sibling = c->win;
+        wc.stack_mode = Above;
+        XConfigureWindow(dpy, c->frame, CWSibling|CWStackMode, &wc);
     }
-#endif
 
-#ifdef XFT
-    c->xftdraw = XftDrawCreate(dpy, c->frame, DefaultVisual(dpy,
-        DefaultScreen(dpy)), DefaultColormap(dpy, DefaultScreen(dpy)));
+#ifdef SHAPE
+    c->shape_ok = False;
+    cli_shape_set(c);
 #endif
 
+    c->visibility = VisibilityUnobscured;
+    c->frame_dirty = False;
     XSaveContext(dpy, c->frame, frame_tab, (XPointer)c);
     XAddToSaveSet(dpy, c->win);
     XSetWindowBorderWidth(dpy, c->win, 0);
     XReparentWindow(dpy, c->win, c->frame, CX(c), CY(c));
-    XMapWindow(dpy, c->win);
-    XSelectInput(dpy, c->win, PropertyChangeMask);
+    XResizeWindow(dpy, c->win, c->geom.w, c->geom.h);
+    scr->wins_stale = True;
+    view_track(c);
+}
+
+/* Undo the above, for a client that has been hidden for a while, is
+ * going fullscreen, or is going away. It gets its own border back, and
+ * leaves the save set, since there's no frame left for the server to
+ * take it out of if we die. Reparenting a mapped window unmaps it, so if
+ * the client is mapped (and staying), the caller must set ign_unmap
+ * first, or the UnmapNotify would look like the client withdrawing. */
+
+void cli_unreparent(Client *c)
+{
+    XSetWindowBorderWidth(dpy, c->win, c->old_bw);
+    XReparentWindow(dpy, c->win, c->scr->root, c->geom.x - VX(c),
+        c->geom.y - VY(c));
+    XRemoveFromSaveSet(dpy, c->win);
+    title_surface_free(c);
+    XDeleteContext(dpy, c->frame, frame_tab);
+    XDestroyWindow(dpy, c->frame);
+    c->frame = None;
+    scr->wins_stale = True;
+    view_track(c);
+}
+
+/* Called when some client has been hidden; tear down the frames of those
+ * that have been out of sight for opt_ht seconds, and come back later for
+ * the rest. */
+
+void cli_frames_reap(void)
+{
+    long now = time_msec(), ht = opt_ht * 1000L, next = -1;
+    unsigned int i;
+    int n;
+    Client *c;
+
+    for (n = 0; n < nscreens; n++) {
+        scr = &screens[n];
+        for (i = 0; i < scr->nwins; i++) {
+            if (FIND_TOP(scr->wins[i], &c) && c->frame && !c->mapped) {
+                if (now - c->hidden_at >= ht)
+                    cli_unreparent(c);
+                else if (next < 0 || c->hidden_at + ht - now < next)
+                    next = c->hidden_at + ht - now;
+            }
+        }
+    }
+    if (next >= 0)
+        timer_set(cli_frames_reap, next);
 }
 
 void cli_map_apply(Client *c)
 {
     Geom f = cli_frame_geom(c, c->geom);
 
-    if (!c->frame) return;
+    if (c->frame) {
+        XMoveResizeWindow(dpy, c->frame, f.x, f.y, f.w, f.h);
+        XMoveResizeWindow(dpy, c->win, CX(c), CY(c), c->geom.w, c->geom.h);
+#ifdef SHAPE
+        cli_shape_set(c);
+#endif
+    } else if (!DECOR(c)) {
+        XMoveResizeWindow(dpy, c->win, c->geom.x - VX(c), c->geom.y - VY(c),
+            c->geom.w, c->geom.h);
+    }
 
-    XMoveResizeWindow(dpy, c->frame, f.x, f.y, f.w, f.h);
-    XMoveResizeWindow(dpy, c->win, CX(c), CY(c), c->geom.w, c->geom.h);
-    cli_send_cfg(c);
+    /* A client we configure directly gets a real ConfigureNotify, in root
+     * coordinates, so there's no need to send one of our own. */
+    if (c->frame || DECOR(c))
+        cli_send_cfg(c);
+    cli_index(c);
+    cli_extents_set(c);
 
     if (CLI_ON_CUR_DESK(c) && win_state_get(c->win) == NormalState)
         cli_show(c);
@@ -257,6 +482,101 @@ void cli_map_apply(Client *c)
         cli_hide(c);
 }
 
+/* Give a client that's already up a new geometry, without the showing and
+ * hiding cli_map_apply does (and the round trip for WM_STATE that goes
+ * with it). The client window is only resized if its size changed from
+ * old. */
+
+void cli_geom_apply(Client *c, Geom old)
+{
+    Geom f = cli_frame_geom(c, c->geom);
+
+    XMoveResizeWindow(dpy, c->frame, f.x, f.y, f.w, f.h);
+    if (c->geom.w != old.w || c->geom.h != old.h) {
+        XResizeWindow(dpy, c->win, c->geom.w, c->geom.h);
+#ifdef SHAPE
+        cli_shape_set(c);
+#endif
+        cli_frame_redraw(c);
+    }
+    cli_send_cfg(c);
+    cli_index(c);
+}
+
+/* Whenever we give a client a new geometry, we keep track of where its
+ * frame is in both the snap index and the grid. */
+
+void cli_index(Client *c)
+{
+    snap_index(c);
+    grid_index(c);
+}
+
+void cli_unindex(Client *c)
+{
+    snap_remove(c);
+    grid_remove(c);
+}
+
+/*
+ * _NET_FRAME_EXTENTS tells the client how much of the frame is ours on each
+ * side (left, right, top, bottom), so it can size itself to fit without
+ * mapping, seeing where we put it, and configuring again. Shading and
+ * zooming leave these alone, but fullscreen takes them away; we keep what
+ * we last set so that only a real change costs a request.
+ */
+
+void cli_extents_set(Client *c)
+{
+    unsigned long e[4];
+
+    frame_extents(c, e);
+    if (memcmp(e, c->extents, sizeof e) != 0) {
+        memcpy(c->extents, e, sizeof e);
+        atom_set(c->win, net_frame_extents, XA_CARDINAL, c->extents, 4);
+    }
+}
+
+/* A client that asks with _NET_REQUEST_FRAME_EXTENTS before it maps gets
+ * our best guess from the same hints cli_new will look at. */
+
+void win_extents_set(Window w)
+{
+    Client tmp;
+    unsigned long e[4];
+
+    tmp.trans = None;
+    XGetTransientForHint(dpy, w, &tmp.trans);
+    tmp.decor = win_wants_decor(w);
+    tmp.fullscreen = False;
+    frame_extents(&tmp, e);
+    atom_set(w, net_frame_extents, XA_CARDINAL, e, 4);
+}
+
+static void frame_extents(Client *c, unsigned long *e)
+{
+    e[0] = e[1] = e[3] = BW(c);
+    e[2] = GH(c) + BW(c);
+}
+
+/* Docks, menus and the like, and anything that turns off decorations in
+ * its Motif hints, go without a frame. */
+
+static Bool win_wants_decor(Window w)
+{
+    Atom win_type;
+    unsigned long mwm[MWM_NFIELDS];
+
+    if (atom_get(w, net_wm_wintype, XA_ATOM, 0, &win_type, 1, NULL) && (
+            win_type == net_wm_type_desk || win_type == net_wm_type_dock ||
+            win_type == net_wm_type_menu || win_type == net_wm_type_splash))
+        return False;
+    if (atom_get(w, mwm_hints, mwm_hints, 0, mwm, MWM_NFIELDS, NULL)
+            >= 3 && mwm[0] & MWM_HINTS_DECOR && !mwm[2])
+        return False;
+    return True;
+}
+
 int cli_state_set(Client *c, unsigned long state)
 {
     return atom_set(c->win, wm_state, wm_state, &state, 1);
@@ -271,7 +591,9 @@ void cli_state_apply(Client *c)
     for (i = 0, nr = 1; nr; i += na) {
         na = atom_get(c->win, net_wm_state, XA_ATOM, i, &state, 1, &nr);
         if (na) {
-            if (state == net_wm_state_shaded)
+            if (state == net_wm_state_fs)
+                cli_fullscreen(c);
+            else if (state == net_wm_state_shaded)
                 cli_shade(c);
             else if (state == net_wm_state_mh || state == net_wm_state_mv)
                 cli_grow(c);
@@ -290,8 +612,8 @@ void cli_send_cfg(Client *c)
     ce.type = ConfigureNotify;
     ce.event = c->win;
     ce.window = c->win;
-    ce.x = c->geom.x;
-    ce.y = c->geom.y;
+    ce.x = c->sent_x = c->geom.x - VX(c);
+    ce.y = c->sent_y = c->geom.y - VY(c);
     ce.width = c->geom.w;
     ce.height = c->geom.h;
     ce.border_width = 0;
@@ -310,46 +632,41 @@ void cli_send_cfg(Client *c)
  * division here should match X's line algorithms so that proportions are
  * correct at all border widths. For text, I have subjectively chosen a
  * horizontal space of 1/2 the descender. Vertically, the decender is part of
- * the font; it is in addition to opt_pad. */
+ * the font; it is in addition to opt_pad. The title gets the same space on
+ * its right, before the box, and anything past that is cut off.
+ *
+ * There's no point drawing on a frame nobody can see. If it's completely
+ * covered we just remember that it needs drawing, and do it when it comes
+ * out from under (see ev_visibility). */
 
 void cli_frame_redraw(Client *c)
 {
     int x, y;
 
+    if (c->frame && c->visibility == VisibilityFullyObscured) {
+        c->frame_dirty = True;
+        stats.redraws_skipped++;
+        return;
+    }
+
     if (c->frame && c->decor) {
         XClearWindow(dpy, c->frame);
 
         /* horizontal separator*/
         if (!c->shaded)
-            XDrawLine(dpy, c->frame, bord_gc,
+            XDrawLine(dpy, c->frame, c->vis->bord_gc,
                 0, GH(c) - BW(c) + BW(c)/2,
                 c->geom.w, GH(c) - BW(c) + BW(c)/2);
 
         /* box */
-        XDrawLine(dpy, c->frame, bord_gc,
+        XDrawLine(dpy, c->frame, c->vis->bord_gc,
             c->geom.w - GH(c) + BW(c)/2, 0,
             c->geom.w - GH(c) + BW(c)/2, GH(c));
 
         if (c->name && !c->trans) {
             x = opt_pad + DESCENT/2;
             y = opt_pad + ASCENT;
-#ifdef XFT
-#ifdef X_HAVE_UTF8_STRING
-            XftDrawStringUtf8(c->xftdraw, &xft_fg, xftfont, x, y,
-                (unsigned char *)c->name, strlen(c->name));
-#else
-            XftDrawString8(c->xftdraw, &xft_fg, xftfont, x, y,
-                (unsigned char *)c->name, strlen(c->name));
-#endif
-#else
-#ifdef X_HAVE_UTF8_STRING
-            Xutf8DrawString(dpy, c->frame, font_set, text_gc, x, y,
-                c->name, strlen(c->name));
-#else
-            XDrawString(dpy, c->frame, text_gc, x, y,
-                c->name, strlen(c->name));
-#endif
-#endif
+            title_draw(c, x, y, c->geom.w - GH(c) - 2*x);
         }
     }
 }
@@ -393,9 +710,12 @@ Geom cli_frame_geom(Client *c, Geom f)
 }
 
 /*
- * This gets called when the client adds or removes shaping, and on
- * startup. XShapeGetRectangles tells us how many shapes the client has.
- * 
+ * This gets called when the client adds or removes shaping, when we make
+ * a new frame, and whenever the client might have changed size. We track
+ * whether the client is shaped from ShapeNotify (and one query when we
+ * first see it), so this costs no round trips, and does nothing at all
+ * unless the client's shape or our grip has changed since last time.
+ *
  * If the client window has any shapes, we need to set a shape on the
  * frame to match. It should be the union of the shaped child and the
  * grip portion of our frame. If the client has no shapes, but used to,
@@ -405,22 +725,28 @@ Geom cli_frame_geom(Client *c, Geom f)
 #ifdef SHAPE
 void cli_shape_set(Client *c)
 {
-    int n, order;
-    XRectangle grip, *cli_shapes;
+    XRectangle grip;
+
+    if (!shape || !c->frame) return;
+
+    grip.x = -BW(c);
+    grip.y = -BW(c);
+    grip.width = c->geom.w + 2 * BW(c);
+    grip.height = GH(c) + BW(c);
+
+    if (c->shape_ok && (!c->shaped || (grip.width == c->shape_grip.width &&
+            grip.height == c->shape_grip.height && grip.x == c->shape_grip.x)))
+        return;
 
-    cli_shapes = XShapeGetRectangles(dpy, c->win, ShapeBounding, &n, &order);
-    if (n > 1) {
+    if (c->shaped) {
         XShapeCombineShape(dpy, c->frame, ShapeBounding, CX(c), CY(c), c->win,
             ShapeBounding, ShapeSet);
-        grip.x = -BW(c);
-        grip.y = -BW(c);
-        grip.width = c->geom.w + 2 * BW(c);
-        grip.height = GH(c) + BW(c);
         XShapeCombineRectangles(dpy, c->frame, ShapeBounding, 0, 0, &grip, 1,
             ShapeUnion, YXBanded);
     } else {
         XShapeCombineMask(dpy, c->frame, ShapeBounding, 0, 0, None, ShapeSet);
     }
-    XFree(cli_shapes);
+    c->shape_grip = grip;
+    c->shape_ok = True;
 }
 #endif
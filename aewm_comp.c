@@ -0,0 +1,491 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#ifdef COMPOSITE
+#include <stdlib.h>
+#include <stdio.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/shape.h>
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xrender.h>
+#include "aewm.h"
+
+/*
+ * With opt_cm, we are also the compositing manager. Every child of the
+ * root (frames, clients we haven't framed, override-redirect windows) is
+ * redirected offscreen, and we put them back together on the overlay
+ * window ourselves, bottom to top in the order of wins -- the same list
+ * the rest of the WM uses, so there's no second copy of the stack to keep
+ * in sync.
+ *
+ * We only repaint what changed. Damage reports each drawing operation as
+ * a rectangle (raw reports, so there's nothing to subtract and no round
+ * trip), maps, unmaps and moves add the old and new extents, and all of
+ * it is collected here until the event queue runs dry. Then we paint
+ * just those rectangles into a back buffer and copy them to the overlay.
+ * Everything is plain Render, so it works the same on Xvfb.
+ *
+ * Shaped windows are painted through their bounding shape, so xeyes
+ * doesn't come out as a box. The region is fetched when the window is
+ * next painted after a ShapeNotify or a resize, and only for windows
+ * that are actually shaped; everything else goes straight through.
+ *
+ * Only the default screen is composited. The others are managed as
+ * usual, just without any of this.
+ */
+
+#define NDIRTY 64
+
+typedef struct {
+    Window win;
+    int x, y, w, h, bw;  /* outside of border is x, y, w + 2bw, h + 2bw */
+    Window above;        /* sibling we were last stacked on */
+    Bool mapped;
+    Bool argb;           /* has an alpha channel, so must be blended */
+    Bool shaped;         /* bounding shape isn't just the rectangle */
+    XserverRegion shape; /* that shape, from the outside corner */
+    XRenderPictFormat *fmt;
+    Damage damage;
+    Pixmap pixmap;       /* named contents, made when first painted */
+    Picture pict;
+} CompWin;
+
+static void comp_add(Window);
+static void comp_del(Window, Bool);
+static void comp_configure(XConfigureEvent *);
+static void comp_damaged(XDamageNotifyEvent *);
+static void comp_reshaped(XShapeEvent *);
+static void comp_release(CompWin *);
+static void comp_dirty(int, int, int, int);
+static void comp_dirty_win(CompWin *);
+static void comp_bg_update(void);
+
+static ScreenInfo *cs;
+static XContext comp_tab;
+static int damage_event;
+static int shape_notify = -1;
+static Window overlay;
+static Pixmap back;
+static Picture back_pict, screen_pict, bg_pict;
+static XRenderPictFormat *root_fmt;
+static Atom xrootpmap;
+static XRectangle dirty[NDIRTY];
+static int ndirty;
+static long started;
+
+void comp_init(void)
+{
+    int ev_base, err_base, major = 0, minor = 0;
+    unsigned int i;
+    XRenderPictureAttributes pa;
+    XserverRegion none;
+
+    if (!opt_cm) return;
+    if (!XCompositeQueryExtension(dpy, &ev_base, &err_base) ||
+            !XCompositeQueryVersion(dpy, &major, &minor) ||
+            (major == 0 && minor < 3) ||
+            !XDamageQueryExtension(dpy, &damage_event, &err_base) ||
+            !XFixesQueryExtension(dpy, &ev_base, &err_base) ||
+            !XRenderQueryExtension(dpy, &ev_base, &err_base)) {
+        fprintf(stderr, "aewm: compositing needs Composite 0.3, Damage, "
+            "XFixes and Render; not compositing\n");
+        return;
+    }
+
+    if (!(root_fmt = XRenderFindVisualFormat(dpy,
+            DefaultVisual(dpy, scr->num)))) {
+        fprintf(stderr, "aewm: Render has no format for the root's visual; "
+            "not compositing\n");
+        return;
+    }
+    if (XShapeQueryExtension(dpy, &ev_base, &err_base))
+        shape_notify = ev_base + ShapeNotify;
+
+    cs = scr;
+    comp_tab = XUniqueContext();
+    xrootpmap = XInternAtom(dpy, "_XROOTPMAP_ID", False);
+
+    XCompositeRedirectSubwindows(dpy, cs->root, CompositeRedirectManual);
+    overlay = XCompositeGetOverlayWindow(dpy, cs->root);
+    none = XFixesCreateRegion(dpy, NULL, 0);
+    XFixesSetWindowShapeRegion(dpy, overlay, ShapeInput, 0, 0, none);
+    XFixesDestroyRegion(dpy, none);
+    XSelectInput(dpy, overlay, ExposureMask);
+
+    pa.subwindow_mode = IncludeInferiors;
+    screen_pict = XRenderCreatePicture(dpy, overlay, root_fmt,
+        CPSubwindowMode, &pa);
+    back = XCreatePixmap(dpy, cs->root, cs->rw, cs->rh,
+        DefaultDepth(dpy, cs->num));
+    back_pict = XRenderCreatePicture(dpy, back, root_fmt, 0, NULL);
+    comp_bg_update();
+
+    for (i = 0; i < cs->nwins; i++)
+        comp_add(cs->wins[i]);
+    comp_dirty(0, 0, cs->rw, cs->rh);
+    started = time_msec();
+}
+
+void comp_free(void)
+{
+    unsigned int i;
+    CompWin *cw;
+
+    if (!overlay) return;
+    for (i = 0; i < cs->nwins; i++)
+        if (FIND_CTX(cs->wins[i], comp_tab, &cw))
+            comp_del(cs->wins[i], False);
+    XRenderFreePicture(dpy, bg_pict);
+    XRenderFreePicture(dpy, back_pict);
+    XRenderFreePicture(dpy, screen_pict);
+    XFreePixmap(dpy, back);
+    XCompositeReleaseOverlayWindow(dpy, cs->root);
+    XCompositeUnredirectSubwindows(dpy, cs->root, CompositeRedirectManual);
+    overlay = None;
+}
+
+/* We look at everything before ev_loop does, but only to keep track of
+ * what's where; none of this changes anything for the rest of the WM. The
+ * events for the root's children come in through SUB_MASK on the root. */
+
+void comp_event(XEvent *e)
+{
+    CompWin *cw;
+
+    if (!overlay) return;
+
+    switch (e->type) {
+        case CreateNotify:
+            if (e->xcreatewindow.parent == cs->root) {
+                comp_add(e->xcreatewindow.window);
+                cs->wins_stale = True;
+            }
+            break;
+        case DestroyNotify:
+            comp_del(e->xdestroywindow.window, True);
+            break;
+        case ReparentNotify:
+            if (e->xreparent.parent == cs->root) {
+                comp_add(e->xreparent.window);
+                cs->wins_stale = True;
+            } else {
+                comp_del(e->xreparent.window, False);
+            }
+            break;
+        case MapNotify:
+            if (FIND_CTX(e->xmap.window, comp_tab, &cw)) {
+                cw->mapped = True;
+                comp_release(cw);
+                comp_dirty_win(cw);
+            }
+            break;
+        case UnmapNotify:
+            if (FIND_CTX(e->xunmap.window, comp_tab, &cw) && cw->mapped) {
+                comp_dirty_win(cw);
+                cw->mapped = False;
+                comp_release(cw);
+            }
+            break;
+        case ConfigureNotify:
+            comp_configure(&e->xconfigure);
+            break;
+        case Expose:
+            if (e->xexpose.window == overlay)
+                comp_dirty(e->xexpose.x, e->xexpose.y,
+                    e->xexpose.width, e->xexpose.height);
+            break;
+        case PropertyNotify:
+            if (e->xproperty.window == cs->root &&
+                    e->xproperty.atom == xrootpmap) {
+                comp_bg_update();
+                comp_dirty(0, 0, cs->rw, cs->rh);
+            }
+            break;
+        default:
+            if (e->type == damage_event + XDamageNotify)
+                comp_damaged((XDamageNotifyEvent *)e);
+            else if (e->type == shape_notify)
+                comp_reshaped((XShapeEvent *)e);
+            break;
+    }
+}
+
+/* Called when the queue is empty, so a burst of damage turns into one
+ * repaint. Windows entirely outside the damage aren't touched. */
+
+void comp_paint(void)
+{
+    XserverRegion region, clip;
+    XRenderPictureAttributes pa;
+    CompWin *cw;
+    unsigned int i;
+    int j;
+
+    if (!overlay || !ndirty) return;
+
+    region = XFixesCreateRegion(dpy, dirty, ndirty);
+    XFixesSetPictureClipRegion(dpy, back_pict, 0, 0, region);
+    XRenderComposite(dpy, PictOpSrc, bg_pict, None, back_pict,
+        0, 0, 0, 0, 0, 0, cs->rw, cs->rh);
+
+    for (i = 0; i < cs->nwins; i++) {
+        if (!FIND_CTX(cs->wins[i], comp_tab, &cw) || !cw->mapped) continue;
+        for (j = 0; j < ndirty; j++)
+            if (dirty[j].x < cw->x + cw->w + 2 * cw->bw &&
+                    dirty[j].x + dirty[j].width > cw->x &&
+                    dirty[j].y < cw->y + cw->h + 2 * cw->bw &&
+                    dirty[j].y + dirty[j].height > cw->y)
+                break;
+        if (j == ndirty) continue;
+
+        if (!cw->pict) {
+            pa.subwindow_mode = IncludeInferiors;
+            cw->pixmap = XCompositeNameWindowPixmap(dpy, cw->win);
+            cw->pict = XRenderCreatePicture(dpy, cw->pixmap, cw->fmt,
+                CPSubwindowMode, &pa);
+        }
+        if (cw->shaped && !cw->shape) {
+            cw->shape = XFixesCreateRegionFromWindow(dpy, cw->win,
+                WindowRegionBounding);
+            XFixesTranslateRegion(dpy, cw->shape, cw->bw, cw->bw);
+        }
+        if (cw->shape) {
+            clip = XFixesCreateRegion(dpy, NULL, 0);
+            XFixesCopyRegion(dpy, clip, cw->shape);
+            XFixesTranslateRegion(dpy, clip, cw->x, cw->y);
+            XFixesIntersectRegion(dpy, clip, clip, region);
+            XFixesSetPictureClipRegion(dpy, back_pict, 0, 0, clip);
+            XFixesDestroyRegion(dpy, clip);
+        }
+        XRenderComposite(dpy, cw->argb ? PictOpOver : PictOpSrc, cw->pict,
+            None, back_pict, 0, 0, 0, 0, cw->x, cw->y,
+            cw->w + 2 * cw->bw, cw->h + 2 * cw->bw);
+        if (cw->shape)
+            XFixesSetPictureClipRegion(dpy, back_pict, 0, 0, region);
+    }
+
+    XFixesSetPictureClipRegion(dpy, screen_pict, 0, 0, region);
+    XRenderComposite(dpy, PictOpSrc, back_pict, None, screen_pict,
+        0, 0, 0, 0, 0, 0, cs->rw, cs->rh);
+    XFixesDestroyRegion(dpy, region);
+
+    stats.comp_frames++;
+    for (j = 0; j < ndirty; j++)
+        stats.comp_area += (unsigned long)dirty[j].width * dirty[j].height;
+    ndirty = 0;
+}
+
+/* The window everything on s ends up on, if we're compositing it. Anything
+ * drawn straight onto s's root would be hidden under it. */
+
+Window comp_overlay(ScreenInfo *s)
+{
+    return overlay && s == cs ? overlay : None;
+}
+
+/* The back buffer is the size of the screen, so it goes when the screen
+ * is resized. Nothing of the old picture can be kept. */
+
+void comp_resize(ScreenInfo *s)
+{
+    if (!overlay || s != cs) return;
+    XRenderFreePicture(dpy, back_pict);
+    XFreePixmap(dpy, back);
+    back = XCreatePixmap(dpy, cs->root, cs->rw, cs->rh,
+        DefaultDepth(dpy, cs->num));
+    back_pict = XRenderCreatePicture(dpy, back, root_fmt, 0, NULL);
+    ndirty = 0;
+    comp_dirty(0, 0, cs->rw, cs->rh);
+}
+
+void comp_stats_print(void)
+{
+    static long last_at;
+    static unsigned long last_frames;
+    long now = time_msec(), since = last_at ? last_at : started;
+
+    if (!overlay) return;
+    fprintf(stderr, "aewm: compositor: %lu frames (%.1f/s since last "
+        "report), %lu pixels repainted\n", stats.comp_frames,
+        now > since ? (stats.comp_frames - last_frames) * 1000.0 /
+        (now - since) : 0.0, stats.comp_area);
+    last_at = now;
+    last_frames = stats.comp_frames;
+}
+
+/* A window with a visual that Render has no format for (some servers
+ * have those on their default screen) can't be painted, so we leave it
+ * out altogether, as if it were InputOnly. */
+
+static void comp_add(Window w)
+{
+    XWindowAttributes attr;
+    XRenderPictFormat *fmt;
+    CompWin *cw;
+    int bounding, clipped, x, y;
+    unsigned int width, height;
+
+    if (w == overlay || FIND_CTX(w, comp_tab, &cw)) return;
+    if (!XGetWindowAttributes(dpy, w, &attr) || attr.class == InputOnly)
+        return;
+    if (!(fmt = XRenderFindVisualFormat(dpy, attr.visual))) return;
+    if (!(cw = malloc(sizeof *cw))) return;
+
+    cw->win = w;
+    cw->x = attr.x;
+    cw->y = attr.y;
+    cw->w = attr.width;
+    cw->h = attr.height;
+    cw->bw = attr.border_width;
+    cw->above = None;
+    cw->mapped = attr.map_state == IsViewable;
+    cw->fmt = fmt;
+    cw->argb = fmt->type == PictTypeDirect && fmt->direct.alphaMask;
+    cw->damage = XDamageCreate(dpy, w, XDamageReportRawRectangles);
+    cw->pixmap = None;
+    cw->pict = None;
+    cw->shaped = False;
+    cw->shape = None;
+    if (shape_notify != -1) {
+        XShapeSelectInput(dpy, w, ShapeNotifyMask);
+        if (XShapeQueryExtents(dpy, w, &bounding, &x, &y, &width, &height,
+                &clipped, &x, &y, &width, &height))
+            cw->shaped = bounding;
+    }
+    XSaveContext(dpy, w, comp_tab, (XPointer)cw);
+
+    if (cw->mapped) comp_dirty_win(cw);
+}
+
+/* If the window is already gone, so is its Damage. */
+
+static void comp_del(Window w, Bool gone)
+{
+    CompWin *cw;
+
+    if (!FIND_CTX(w, comp_tab, &cw)) return;
+    if (cw->mapped) comp_dirty_win(cw);
+    comp_release(cw);
+    if (!gone) XDamageDestroy(dpy, cw->damage);
+    XDeleteContext(dpy, w, comp_tab);
+    free(cw);
+}
+
+/* A window gets new storage whenever it's mapped or resized, so the old
+ * pixmap has to be let go and named again, and its shape may have been
+ * scaled along with it. Moving keeps both. */
+
+static void comp_configure(XConfigureEvent *e)
+{
+    CompWin *cw;
+
+    if (!FIND_CTX(e->window, comp_tab, &cw)) return;
+
+    if (cw->mapped) comp_dirty_win(cw);
+    if (e->width != cw->w || e->height != cw->h || e->border_width != cw->bw)
+        comp_release(cw);
+    cw->x = e->x;
+    cw->y = e->y;
+    cw->w = e->width;
+    cw->h = e->height;
+    cw->bw = e->border_width;
+    if (e->above != cw->above) {
+        cw->above = e->above;
+        cs->wins_stale = True;
+    }
+    if (cw->mapped) comp_dirty_win(cw);
+}
+
+static void comp_damaged(XDamageNotifyEvent *e)
+{
+    CompWin *cw;
+
+    if (FIND_CTX(e->drawable, comp_tab, &cw) && cw->mapped)
+        comp_dirty(cw->x + cw->bw + e->area.x, cw->y + cw->bw + e->area.y,
+            e->area.width, e->area.height);
+}
+
+/* Both the old and new shapes have to be repainted, and the window's
+ * bounding box covers them. */
+
+static void comp_reshaped(XShapeEvent *e)
+{
+    CompWin *cw;
+
+    if (e->kind != ShapeBounding || !FIND_CTX(e->window, comp_tab, &cw))
+        return;
+    cw->shaped = e->shaped;
+    if (cw->shape) XFixesDestroyRegion(dpy, cw->shape);
+    cw->shape = None;
+    if (cw->mapped) comp_dirty_win(cw);
+}
+
+static void comp_release(CompWin *cw)
+{
+    if (cw->pict) XRenderFreePicture(dpy, cw->pict);
+    if (cw->pixmap) XFreePixmap(dpy, cw->pixmap);
+    if (cw->shape) XFixesDestroyRegion(dpy, cw->shape);
+    cw->pict = None;
+    cw->pixmap = None;
+    cw->shape = None;
+}
+
+/* Once there are too many rectangles to be worth keeping apart, they're
+ * merged into their bounding box. */
+
+static void comp_dirty(int x, int y, int w, int h)
+{
+    int i, l, t, r, b;
+
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > cs->rw) w = cs->rw - x;
+    if (y + h > cs->rh) h = cs->rh - y;
+    if (w <= 0 || h <= 0) return;
+
+    if (ndirty == NDIRTY) {
+        l = x; t = y; r = x + w; b = y + h;
+        for (i = 0; i < ndirty; i++) {
+            if (dirty[i].x < l) l = dirty[i].x;
+            if (dirty[i].y < t) t = dirty[i].y;
+            if (dirty[i].x + dirty[i].width > r)
+                r = dirty[i].x + dirty[i].width;
+            if (dirty[i].y + dirty[i].height > b)
+                b = dirty[i].y + dirty[i].height;
+        }
+        x = l; y = t; w = r - l; h = b - t;
+        ndirty = 0;
+    }
+    dirty[ndirty].x = x;
+    dirty[ndirty].y = y;
+    dirty[ndirty].width = w;
+    dirty[ndirty].height = h;
+    ndirty++;
+}
+
+static void comp_dirty_win(CompWin *cw)
+{
+    comp_dirty(cw->x, cw->y, cw->w + 2 * cw->bw, cw->h + 2 * cw->bw);
+}
+
+/* What's under all the windows: the pixmap set by whatever put up the
+ * wallpaper, if there is one, or black. */
+
+static void comp_bg_update(void)
+{
+    unsigned long pm;
+    XRenderPictureAttributes pa;
+    XRenderColor black = { 0, 0, 0, 0xffff };
+
+    if (bg_pict) XRenderFreePicture(dpy, bg_pict);
+    if (atom_get(cs->root, xrootpmap, XA_PIXMAP, 0, &pm, 1, NULL) && pm) {
+        pa.repeat = True;
+        bg_pict = XRenderCreatePicture(dpy, pm, root_fmt, CPRepeat, &pa);
+    } else {
+        bg_pict = XRenderCreateSolidFill(dpy, &black);
+    }
+}
+#endif
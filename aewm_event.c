@@ -5,10 +5,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/select.h>
+#include <sys/time.h>
 #include <X11/Xatom.h>
 #ifdef SHAPE
 #include <X11/extensions/shape.h>
 #endif
+#ifdef RANDR
+#include <X11/extensions/Xrandr.h>
+#endif
 #include "aewm.h"
 
 static void ev_btn_press(XButtonEvent *);
@@ -19,14 +23,29 @@ static void ev_map_req(XMapRequestEvent *);
 static void ev_unmap(XUnmapEvent *);
 static void ev_destroy(XDestroyWindowEvent *);
 static void ev_message(XClientMessageEvent *);
+static void ev_state_msg(Client *, long, Atom, Atom);
+static void ev_moveresize_msg(Client *, long *);
 static void ev_prop_change(XPropertyEvent *);
 static void ev_enter(XCrossingEvent *);
 static void ev_cmap_change(XColormapEvent *);
 static void ev_expose(XExposeEvent *);
+static void ev_visibility(XVisibilityEvent *);
 #ifdef SHAPE
 static void ev_shape_change(XShapeEvent *);
 #endif
-static void desk_switch_to(int new_desk);
+static struct timeval *timer_next(struct timeval *tv);
+static void timer_run(void);
+
+#define NTIMERS 8
+
+#define NET_STATE_REMOVE 0
+#define NET_STATE_ADD 1
+#define NET_STATE_TOGGLE 2
+
+static struct {
+    TimerFunc *fn;
+    long when;
+} timers[NTIMERS];
 
 /*
  * This is a big hack to avoid blocking in Xlib, where we cannot safely
@@ -55,24 +74,112 @@ static void desk_switch_to(int new_desk);
  * delivered while we're in Xlib. Basically, we are screwed until I port
  * this to XCB. (In the meantime, I have at least never actually seen
  * this race condition happen in real life.)
+ *
+ * Since we're sitting in select() anyway, this is also where timers
+ * fire: we sleep no longer than the nearest one, and run whatever is due
+ * before looking at the queue again.
  */
 
 Bool event_get_next(long mask, XEvent *ev)
 {
     int fd = ConnectionNumber(dpy);
     fd_set rd;
+    struct timeval tv;
 
+    timer_run();
     while (!(mask ? XCheckMaskEvent(dpy, mask, ev)
                   : (XPending(dpy) && XNextEvent(dpy, ev) == Success))) {
+#ifdef COMPOSITE
+        if (!mask) {
+            comp_paint();
+            XFlush(dpy);
+        }
+#endif
         FD_ZERO(&rd);
         FD_SET(fd, &rd);
-        select(fd + 1, &rd, NULL, NULL, NULL);
+        select(fd + 1, &rd, NULL, NULL, timer_next(&tv));
         if (timed_out || killed)
             return False;
+        if (stats_wanted) {
+            stats_wanted = 0;
+            stats_print();
+        }
+        if (children_exited) {
+            children_exited = 0;
+            spawn_reap();
+        }
+        timer_run();
     }
     return True;
 }
 
+/* Timers are one-shot and identified by their function; setting one that's
+ * already pending only ever brings it closer. There are only a handful of
+ * them, each of which looks after its own list of things to do. */
+
+void timer_set(TimerFunc *fn, long msec)
+{
+    long when = time_msec() + (msec > 0 ? msec : 0);
+    int i, slot = -1;
+
+    for (i = 0; i < NTIMERS; i++) {
+        if (timers[i].fn == fn) {
+            if (when < timers[i].when) timers[i].when = when;
+            return;
+        } else if (!timers[i].fn && slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        timers[slot].fn = fn;
+        timers[slot].when = when;
+    }
+}
+
+void timer_clear(TimerFunc *fn)
+{
+    int i;
+
+    for (i = 0; i < NTIMERS; i++)
+        if (timers[i].fn == fn) timers[i].fn = NULL;
+}
+
+static struct timeval *timer_next(struct timeval *tv)
+{
+    long now = time_msec(), wait = -1;
+    int i;
+
+    for (i = 0; i < NTIMERS; i++)
+        if (timers[i].fn && (wait < 0 || timers[i].when - now < wait))
+            wait = timers[i].when - now > 0 ? timers[i].when - now : 0;
+
+    if (wait < 0)
+        return NULL;
+    tv->tv_sec = wait / 1000;
+    tv->tv_usec = wait % 1000 * 1000;
+    return tv;
+}
+
+/* Clear each slot before calling, so the function can set itself again.
+ * Timers aren't about any one screen, so they pick their own, and we put
+ * back whichever one we were on. */
+
+static void timer_run(void)
+{
+    long now = time_msec();
+    ScreenInfo *was = scr;
+    TimerFunc *fn;
+    int i;
+
+    for (i = 0; i < NTIMERS; i++) {
+        if ((fn = timers[i].fn) && timers[i].when - now <= 0) {
+            timers[i].fn = NULL;
+            fn();
+        }
+    }
+    scr = was;
+}
+
 /* By the time we get an event, there is no guarantee the window still
  * exists. Therefore ev_print might cause errors. We'll just live with it. */
 
@@ -80,29 +187,63 @@ void ev_loop(void)
 {
     XEvent ev;
 
-    while (event_get_next(NoEventMask, &ev)) {
-        IF_DEBUG(ev_print(ev));
-        switch (ev.type) {
-            case ButtonPress: ev_btn_press(&ev.xbutton); break;
-            case ButtonRelease: ev_btn_release(&ev.xbutton); break;
-            case ConfigureRequest: ev_cfg_req(&ev.xconfigurerequest); break;
-            case CirculateRequest: ev_circ_req(&ev.xcirculaterequest); break;
-            case MapRequest: ev_map_req(&ev.xmaprequest); break;
-            case UnmapNotify: ev_unmap(&ev.xunmap); break;
-            case DestroyNotify: ev_destroy(&ev.xdestroywindow); break;
-            case ClientMessage: ev_message(&ev.xclient); break;
-            case ColormapNotify: ev_cmap_change(&ev.xcolormap); break;
-            case PropertyNotify: ev_prop_change(&ev.xproperty); break;
-            case EnterNotify: ev_enter(&ev.xcrossing); break;
-            case Expose: ev_expose(&ev.xexpose); break;
+    while (event_get_next(NoEventMask, &ev))
+        ev_dispatch(&ev);
+}
+
+/* Split out so that an opaque sweep, which leaves the server ungrabbed,
+ * can keep up with everything else while it has the pointer. That means
+ * we might be in the middle of something on one screen, so once the event
+ * has been dealt with on its own screen, we go back to that one. */
+
+void ev_dispatch(XEvent *ev)
+{
+    ScreenInfo *was = scr, *s;
+    int i;
+
+    if ((s = scr_find(ev->xany.window)))
+        scr = s;
+    IF_DEBUG(ev_print(*ev));
+#ifdef COMPOSITE
+    comp_event(ev);
+#endif
+    switch (ev->type) {
+        case ButtonPress: ev_btn_press(&ev->xbutton); break;
+        case ButtonRelease: ev_btn_release(&ev->xbutton); break;
+        case ConfigureRequest: ev_cfg_req(&ev->xconfigurerequest); break;
+        case CirculateRequest: ev_circ_req(&ev->xcirculaterequest); break;
+        case MapRequest: ev_map_req(&ev->xmaprequest); break;
+        case UnmapNotify: ev_unmap(&ev->xunmap); break;
+        case DestroyNotify: ev_destroy(&ev->xdestroywindow); break;
+        case ClientMessage: ev_message(&ev->xclient); break;
+        case ColormapNotify: ev_cmap_change(&ev->xcolormap); break;
+        case PropertyNotify: ev_prop_change(&ev->xproperty); break;
+        case EnterNotify: ev_enter(&ev->xcrossing); break;
+        case KeyPress: bind_key(&ev->xkey); break;
+        case Expose: ev_expose(&ev->xexpose); break;
+        case VisibilityNotify: ev_visibility(&ev->xvisibility); break;
+        default:
 #ifdef SHAPE
-            default:
-                if (shape && ev.type == shape_event)
-                    ev_shape_change((XShapeEvent *)&ev);
-                break;
+            if (shape && ev->type == shape_event)
+                ev_shape_change((XShapeEvent *)ev);
+#endif
+#ifdef SYNC
+            if (xsync && ev->type == xsync_event + XSyncAlarmNotify)
+                cli_sync_alarm((XSyncAlarmNotifyEvent *)ev);
 #endif
+#ifdef RANDR
+            if (randr && ev->type == randr_event + RRScreenChangeNotify)
+                output_changed(ev);
+#endif
+            break;
+    }
+    for (i = 0; i < nscreens; i++) {
+        if (screens[i].wins_stale) {
+            scr = &screens[i];
+            win_list_update();
         }
     }
+    scr = was;
 }
 
 /* Someone clicked a button. If they clicked on a window, we want the button
@@ -126,15 +267,9 @@ static void ev_btn_press(XButtonEvent *e)
 
 static void ev_btn_release(XButtonEvent *e)
 {
-    if (pressed == root && e->window == root) {
+    if (pressed == scr->root && e->window == scr->root) {
         IF_DEBUG(cli_list());
-        switch (e->button) {
-            case Button1: fork_exec(opt_new[0]); break;
-            case Button2: fork_exec(opt_new[1]); break;
-            case Button3: fork_exec(opt_new[2]); break;
-            case Button4: fork_exec(opt_new[3]); break;
-            case Button5: fork_exec(opt_new[4]); break;
-        }
+        bind_button(e);
         pressed = None;
     }
 }
@@ -142,7 +277,9 @@ static void ev_btn_release(XButtonEvent *e)
 /* Because we are redirecting the root window, we get ConfigureRequest events
  * from both clients we're handling and ones that we aren't. For clients we
  * manage, we need to adjust the frame and the client window, and for
- * unmanaged windows we have to pass along everything unchanged.
+ * unmanaged windows we have to pass along everything unchanged. A client
+ * without a frame is configured directly; if it's one we'll never frame
+ * (it's undecorated), it may restack itself and set its border as well.
  *
  * Most of the assignments here are going to be garbage, but only the ones
  * that are masked in by e->value_mask will be looked at by the X server. */
@@ -161,14 +298,20 @@ static void ev_cfg_req(XConfigureRequestEvent *e)
     wc.stack_mode = e->detail;
 
     if (FIND_CTX(e->window, cli_tab, &c)) {
-        if (!c->cfg_lock) {
+        /* A fullscreen client stays the size of the screen, and a tiled one
+         * the size of its tile; tell it so. */
+        if (c->fullscreen || tile_owns(c)) {
+            cli_send_cfg(c);
+            return;
+        }
+        if (!c->cfg_lock || !c->frame) {
             if (c->zoomed && e->value_mask & (CWX|CWY|CWWidth|CWHeight)) {
                 c->zoomed = False;
                 atom_del(c->win, net_wm_state, XA_ATOM, net_wm_state_mv);
                 atom_del(c->win, net_wm_state, XA_ATOM, net_wm_state_mh);
             }
-            if (e->value_mask & CWX) c->geom.x = e->x;
-            if (e->value_mask & CWY) c->geom.y = e->y;
+            if (e->value_mask & CWX) c->geom.x = e->x + VX(c);
+            if (e->value_mask & CWY) c->geom.y = e->y + VY(c);
             if (e->value_mask & CWWidth) c->geom.w = e->width;
             if (e->value_mask & CWHeight) c->geom.h = e->height;
             IF_DEBUG(cli_print(c, "<cfg>"));
@@ -177,6 +320,17 @@ static void ev_cfg_req(XConfigureRequestEvent *e)
         if (e->value_mask & (CWWidth|CWHeight)) cli_shape_set(c);
 #endif
         cli_send_cfg(c);
+        cli_index(c);
+
+        if (!c->frame) {
+            wc.x = c->geom.x - VX(c);
+            wc.y = c->geom.y - VY(c);
+            XConfigureWindow(dpy, e->window, e->value_mask &
+                (c->decor ? CWX|CWY|CWWidth|CWHeight : ~0), &wc);
+            if (!c->decor && e->value_mask & CWStackMode)
+                scr->wins_stale = True;
+            return;
+        }
 
         wc.x = CX(c);
         wc.y = CY(c);
@@ -197,15 +351,23 @@ static void ev_cfg_req(XConfigureRequestEvent *e)
 /* The only window that we will circulate children for is the root (because
  * nothing else would make sense). After a client requests that the root's
  * children be circulated, the server will determine which window needs to be
- * raised or lowered, and so all we have to do is make it so. */
+ * raised or lowered, and so all we have to do is make it so, short of
+ * putting it over a fullscreen client or under a view's box (see
+ * cli_restack and cli_lower). */
 
 static void ev_circ_req(XCirculateRequestEvent *e)
 {
-    if (e->parent == root) {
-        if (e->place == PlaceOnBottom)
-            XLowerWindow(dpy, e->window);
-        else
-            XRaiseWindow(dpy, e->window);
+    Client *c;
+
+    if (e->parent == scr->root) {
+        if (!FIND_TOP(e->window, &c)) {
+            if (e->place == PlaceOnBottom) XLowerWindow(dpy, e->window);
+            else XRaiseWindow(dpy, e->window);
+        } else if (e->place == PlaceOnBottom) {
+            cli_lower(c);
+        } else {
+            cli_restack(c);
+        }
     }
 }
 
@@ -265,25 +427,122 @@ static void ev_message(XClientMessageEvent *e)
 {
     Client *c;
 
-    if (e->window == root) {
+    /* This one comes before the window is ours, if it's going to be. */
+    if (e->message_type == net_req_frame_extents) {
+        if (FIND_CTX(e->window, cli_tab, &c))
+            atom_set(c->win, net_frame_extents, XA_CARDINAL, c->extents, 4);
+        else
+            win_extents_set(e->window);
+    } else if (e->window == scr->root) {
         if (e->message_type == net_cur_desk && e->format == 32)
             desk_switch_to(e->data.l[0]);
         else if (e->message_type == net_num_desks && e->format == 32)
-            ndesks = e->data.l[0];
+            scr->ndesks = e->data.l[0];
+        else if (e->message_type == net_desk_viewport && e->format == 32)
+            view_pan(scr->cur_desk, e->data.l[0], e->data.l[1]);
     } else if (FIND_CTX(e->window, cli_tab, &c)) {
         if (e->message_type == wm_change_state && e->format == 32 &&
                 e->data.l[0] == IconicState) {
             cli_set_iconified(c, IconicState);
         } else if (e->message_type == net_active_window && e->format == 32) {
-            c->desk = cur_desk;
+            view_desk_set(c, scr->cur_desk);
             cli_set_iconified(c, NormalState);
             cli_raise(c);
+            view_show(c);
         } else if (e->message_type == net_close_window && e->format == 32) {
             cli_req_close(c);
+        } else if (e->message_type == net_wm_state && e->format == 32) {
+            ev_state_msg(c, e->data.l[0], e->data.l[1], e->data.l[2]);
+        } else if (e->message_type == net_wm_moveresize && e->format == 32) {
+            cli_moveresize(c, e->data.l[2], e->data.l[3]);
+        } else if (e->message_type == net_moveresize_window &&
+                e->format == 32) {
+            ev_moveresize_msg(c, e->data.l);
         }
     }
 }
 
+/*
+ * _NET_MOVERESIZE_WINDOW is a ConfigureRequest with its own gravity (in
+ * the low byte of l[0]; 0 means the client's usual one) and flags for
+ * which of x, y, width and height it sets. We work out where the frame
+ * should go by that gravity, and then where the client goes in that frame
+ * by its own, so the rest of the WM never has to know. It all goes out at
+ * once, rather than as a move and then a resize.
+ */
+
+static void ev_moveresize_msg(Client *c, long *l)
+{
+    int grav = l[0] & 0xff;
+    XSizeHints size = c->size;
+    Geom g = c->geom, old = c->geom, f, f2;
+
+    if (c->fullscreen || tile_owns(c)) {
+        cli_send_cfg(c);
+        return;
+    }
+    if (c->zoomed && l[0] & (0xf << 8)) {
+        c->zoomed = False;
+        atom_del(c->win, net_wm_state, XA_ATOM, net_wm_state_mv);
+        atom_del(c->win, net_wm_state, XA_ATOM, net_wm_state_mh);
+    }
+    if (l[0] & 1 << 8) g.x = l[1] + VX(c);
+    if (l[0] & 1 << 9) g.y = l[2] + VY(c);
+    if (l[0] & 1 << 10) g.w = l[3];
+    if (l[0] & 1 << 11) g.h = l[4];
+
+    c->geom = g;
+    if (grav && grav != GRAV(c)) {
+        c->size.flags |= PWinGravity;
+        c->size.win_gravity = grav;
+        f = cli_frame_geom(c, g);
+        c->size = size;
+        f2 = cli_frame_geom(c, g);
+        c->geom.x += f.x - f2.x;
+        c->geom.y += f.y - f2.y;
+    }
+    IF_DEBUG(cli_print(c, "<mvr>"));
+
+    if (c->frame) {
+        cli_geom_apply(c, old);
+    } else {
+        XMoveResizeWindow(dpy, c->win, c->geom.x - VX(c), c->geom.y - VY(c),
+            c->geom.w, c->geom.h);
+        if (c->decor)
+            cli_send_cfg(c);
+        cli_index(c);
+    }
+}
+
+/* A _NET_WM_STATE message changes up to two states at once. Maximizing
+ * is one state to us, so the usual pair of MAXIMIZED_VERT and _HORZ only
+ * gets toggled once. */
+
+static void ev_state_msg(Client *c, long action, Atom a, Atom b)
+{
+    Bool on;
+
+    if (a == net_wm_state_fs || b == net_wm_state_fs) {
+        on = action == NET_STATE_ADD ||
+            (action == NET_STATE_TOGGLE && !c->fullscreen);
+        if (on) cli_fullscreen(c);
+        else cli_unfullscreen(c);
+    }
+    if (a == net_wm_state_mv || a == net_wm_state_mh ||
+            b == net_wm_state_mv || b == net_wm_state_mh) {
+        on = action == NET_STATE_ADD ||
+            (action == NET_STATE_TOGGLE && !c->zoomed);
+        if (on) cli_grow(c);
+        else cli_shrink(c);
+    }
+    if (a == net_wm_state_shaded || b == net_wm_state_shaded) {
+        on = action == NET_STATE_ADD ||
+            (action == NET_STATE_TOGGLE && !c->shaded);
+        if (on) cli_shade(c);
+        else cli_unshade(c);
+    }
+}
+
 /* If we have something copied to a variable, or displayed on the screen, make
  * sure it is up to date. If redrawing the name is necessary, clear the window
  * because Xft uses alpha rendering. */
@@ -292,20 +551,26 @@ static void ev_prop_change(XPropertyEvent *e)
 {
     Client *c;
     long supplied;
+    unsigned long desk;
 
     if (FIND_CTX(e->window, cli_tab, &c)) {
         if (e->atom == XA_WM_NAME || e->atom == net_wm_name) {
-            if (c->name) XFree(c->name);
-            c->name = win_name_get(c->win);
-            cli_frame_redraw(c);
+            title_update(c);
         } else if (e->atom == XA_WM_NORMAL_HINTS) {
             XGetWMNormalHints(dpy, c->win, &c->size, &supplied);
         } else if (e->atom == net_wm_state) {
             cli_state_apply(c);
+        } else if (e->atom == net_wm_strut ||
+                e->atom == net_wm_strut_partial) {
+            c->nstrut = win_strut_get(c->win, c->strut);
+            if (c->mapped)
+                tile_dirty(c->desk);
         } else if (e->atom == net_wm_desk) {
-            if (atom_get(c->win, net_wm_desk, XA_CARDINAL, 0, &c->desk, 1,
-                    NULL))
+            if (atom_get(c->win, net_wm_desk, XA_CARDINAL, 0, &desk, 1,
+                    NULL)) {
+                view_desk_set(c, desk);
                 cli_map_apply(c);
+            }
         }
     }
 }
@@ -319,7 +584,7 @@ static void ev_enter(XCrossingEvent *e)
 {
     Client *c;
 
-    if (FIND_CTX(e->window, frame_tab, &c))
+    if (FIND_TOP(e->window, &c))
         cli_focus(c);
 }
 
@@ -361,29 +626,82 @@ static void ev_expose(XExposeEvent *e)
     }
 }
 
+static void ev_visibility(XVisibilityEvent *e)
+{
+    Client *c;
+
+    if (FIND_CTX(e->window, frame_tab, &c)) {
+        c->visibility = e->state;
+        if (c->frame_dirty && e->state != VisibilityFullyObscured) {
+            c->frame_dirty = False;
+            stats.redraws_deferred++;
+            cli_frame_redraw(c);
+        }
+    }
+}
+
 #ifdef SHAPE
 static void ev_shape_change(XShapeEvent *e)
 {
     Client *c;
 
-    if (FIND_CTX(e->window, cli_tab, &c))
+    if (e->kind == ShapeBounding && FIND_CTX(e->window, cli_tab, &c)) {
+        c->shaped = e->shaped;
+        c->shape_ok = False;
         cli_shape_set(c);
+    }
 }
 #endif
 
-static void desk_switch_to(int new_desk)
+void stats_print(void)
+{
+    fprintf(stderr, "aewm: titles: %lu drawn, %lu dropped\n",
+        stats.title_draws, stats.title_dropped);
+    fprintf(stderr, "aewm: frames: %lu redraws skipped while covered, "
+        "%lu made up later\n", stats.redraws_skipped, stats.redraws_deferred);
+    fprintf(stderr, "aewm: sweeps: %lu geometries applied, %lu merged, "
+        "%lu motion events skipped\n", stats.sweep_applied, stats.sweep_merged,
+        stats.motion_merged);
+    fprintf(stderr, "aewm: tiles: %lu windows moved or resized\n",
+        stats.tiles_moved);
+    fprintf(stderr, "aewm: bindings: %lu actions done, %lu commands run\n",
+        stats.bind_actions, stats.bind_execs);
+    fprintf(stderr, "aewm: spawns: %lu started (%lu without a shell), "
+        "%lu failed, %lu reaped; %ld usec each on average, %ld at most\n",
+        spawn_stats.started, spawn_stats.direct, spawn_stats.failed,
+        spawn_stats.reaped, spawn_stats.started ?
+        spawn_stats.usec_total / (long)spawn_stats.started : 0,
+        spawn_stats.usec_max);
+    fprintf(stderr, "aewm: viewports: %lu pans, %lu configures sent after\n",
+        stats.view_pans, stats.view_notified);
+#ifdef RANDR
+    fprintf(stderr, "aewm: outputs: %lu changes, %lu windows refitted\n",
+        stats.output_changes, stats.output_refits);
+#endif
+#ifdef SYNC
+    fprintf(stderr, "aewm: sync: %lu requests sent, %lu timed out\n",
+        stats.sync_requests, stats.sync_timeouts);
+#endif
+#ifdef COMPOSITE
+    comp_stats_print();
+#endif
+}
+
+void desk_switch_to(int new_desk)
 {
+    unsigned long from = scr->cur_desk;
     unsigned int i;
     Client *c;
 
-    cur_desk = new_desk;
-    atom_set(root, net_cur_desk, XA_CARDINAL, &cur_desk, 1);
+    scr->cur_desk = new_desk;
+    atom_set(scr->root, net_cur_desk, XA_CARDINAL, &scr->cur_desk, 1);
+    view_desk_switch(from);
 
-    for (i = 0; i < nwins; i++)
-        if (FIND_CTX(wins[i], frame_tab, &c) && !CLI_ON_CUR_DESK(c))
+    for (i = 0; i < scr->nwins; i++)
+        if (FIND_TOP(scr->wins[i], &c) && !CLI_ON_CUR_DESK(c))
             cli_hide(c);
     while (i--)
-        if (FIND_CTX(wins[i], frame_tab, &c) && CLI_ON_CUR_DESK(c)
+        if (FIND_TOP(scr->wins[i], &c) && CLI_ON_CUR_DESK(c)
                 && win_state_get(c->win) == NormalState)
             cli_show(c);
 }
@@ -416,6 +734,7 @@ void ev_print(XEvent e)
         case ReparentNotify: n = "ParNfy"; w = e.xreparent.window; break;
         case ResizeRequest: n = "ResizReq"; w = e.xresizerequest.window; break;
         case UnmapNotify: n = "UnmapNfy"; w = e.xunmap.window; break;
+        case VisibilityNotify: n = "VisiNfy"; w = e.xvisibility.window; break;
         default:
 #ifdef SHAPE
             if (shape && e.type == shape_event) {
@@ -470,7 +789,12 @@ void cli_print(Client *c, const char *label)
     if (c->trans) printf(" tr");
     if (c->shaded) printf(" sh");
     if (c->zoomed) printf(" zm");
+    if (c->fullscreen) printf(" fs");
+    if (c->visibility == VisibilityFullyObscured) printf(" ob");
+    if (c->frame_dirty) printf(" dt");
     if (c->ign_unmap) printf(" ig");
+    if (!c->frame) printf(" nf");
+    if (c->title_dropped) printf(" td%lu", c->title_dropped);
     printf("\n");
 }
 
@@ -478,7 +802,7 @@ void win_print(Window w, const char *label)
 {
     Client *c;
 
-    if (w == root)
+    if (w == scr->root)
         printf("%9.9s: %#010lx [r]\n", label, w);
     else if (FIND_CTX(w, cli_tab, &c))
         cli_print(c, label);
@@ -494,10 +818,10 @@ void cli_list(void)
     Client *c;
     unsigned int i;
 
-    for (i = 0; i < nwins; i++) {
-        if (FIND_CTX(wins[i], frame_tab, &c)) {
+    for (i = 0; i < scr->nwins; i++) {
+        if (FIND_TOP(scr->wins[i], &c)) {
             cli_print(c, "<list>");
-            win_print(c->frame, "<list>");
+            if (c->frame) win_print(c->frame, "<list>");
         }
     }
 }
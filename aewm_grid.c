@@ -0,0 +1,244 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <stdlib.h>
+#include "aewm.h"
+
+/*
+ * Where the frames are, so that "which window is at this point" and "which
+ * window is to the left of this one" don't have to go to the server. The
+ * screen is cut into GRID_CELL pixel squares, and each cell lists every
+ * client whose frame touches it. A frame that hangs off the screen is
+ * filed under the cells along the edge. Hidden clients stay where they
+ * were and are skipped when we look, the same as in the snap index.
+ *
+ * Like the snap index, a client is refiled whenever we set its geometry
+ * (cli_index) and dropped when it goes away (cli_unindex). With desks
+ * bigger than the screen, the grid covers a whole desk, and everything is
+ * in the current desk's coordinates (see view_frame_geom). Each screen has
+ * a grid of its own.
+ */
+
+#define GRID_CELL 128
+
+typedef struct Cell {
+    Client **c;
+    int n, size;
+} Cell;
+
+static Bool grid_init(void);
+static void cell_add(Cell *cell, Client *c);
+static void cell_del(Cell *cell, Client *c);
+static Bool usable(Client *c, Client *from);
+
+void grid_index(Client *c)
+{
+    Geom f = view_frame_geom(c);
+    int x, y, gw, gh;
+
+    grid_remove(c);
+    if (!scr->cells && !grid_init())
+        return;
+    gw = scr->gw;
+    gh = scr->gh;
+
+    c->gx0 = L(f, c) / GRID_CELL;
+    c->gy0 = T(f, c) / GRID_CELL;
+    c->gx1 = (R(f, c) - 1) / GRID_CELL;
+    c->gy1 = (B(f, c) - 1) / GRID_CELL;
+    if (c->gx0 < 0) c->gx0 = 0;
+    if (c->gy0 < 0) c->gy0 = 0;
+    if (c->gx1 >= gw) c->gx1 = gw - 1;
+    if (c->gy1 >= gh) c->gy1 = gh - 1;
+    if (c->gx0 >= gw) c->gx0 = gw - 1;
+    if (c->gy0 >= gh) c->gy0 = gh - 1;
+    if (c->gx1 < c->gx0) c->gx1 = c->gx0;
+    if (c->gy1 < c->gy0) c->gy1 = c->gy0;
+
+    for (y = c->gy0; y <= c->gy1; y++)
+        for (x = c->gx0; x <= c->gx1; x++)
+            cell_add(&scr->cells[y * gw + x], c);
+    c->gridded = True;
+}
+
+void grid_remove(Client *c)
+{
+    int x, y;
+
+    if (!c->gridded)
+        return;
+    for (y = c->gy0; y <= c->gy1; y++)
+        for (x = c->gx0; x <= c->gx1; x++)
+            cell_del(&c->scr->cells[y * c->scr->gw + x], c);
+    c->gridded = False;
+}
+
+/* The topmost shown client whose frame covers (x, y), if any. */
+
+Client *grid_at(long x, long y)
+{
+    Cell *cell;
+    Client *c, *top = NULL;
+    Geom f;
+    int i;
+
+    if (!scr->cells || x < 0 || y < 0 || x >= scr->desk_w ||
+            y >= scr->desk_h)
+        return NULL;
+
+    cell = &scr->cells[(y / GRID_CELL) * scr->gw + x / GRID_CELL];
+    for (i = 0; i < cell->n; i++) {
+        c = cell->c[i];
+        f = view_frame_geom(c);
+        if (c->mapped && x >= L(f, c) && x < R(f, c) && y >= T(f, c) &&
+                y < B(f, c) && (!top || c->stack > top->stack))
+            top = c;
+    }
+    return top;
+}
+
+/*
+ * The nearest decorated, shown client in direction dir from the middle of
+ * from's frame (or from (x, y), if from is NULL). Nearness is the distance
+ * between middles in that direction, plus twice how far off to the side
+ * it is, so that something just across from us beats something closer
+ * but way off at an angle.
+ *
+ * We walk the grid a column (or row) at a time away from where we start.
+ * Anything we haven't seen yet lies entirely further on than the column
+ * we're about to look at, so once even that is further than the best we
+ * have, we can stop.
+ */
+
+Client *grid_neighbor(Client *from, long x, long y, int dir)
+{
+    Client *c, *best = NULL;
+    Cell *cell;
+    Geom f;
+    long score, best_score = 0, along, side, bound;
+    int horiz = dir == DIR_LEFT || dir == DIR_RIGHT;
+    int sign = dir == DIR_LEFT || dir == DIR_UP ? -1 : 1;
+    int k, j, i, lines, across, gw = scr->gw, gh = scr->gh;
+
+    if (!scr->cells)
+        return NULL;
+    if (from) {
+        f = view_frame_geom(from);
+        x = (L(f, from) + R(f, from)) / 2;
+        y = (T(f, from) + B(f, from)) / 2;
+    }
+
+    lines = horiz ? gw : gh;
+    across = horiz ? gh : gw;
+    k = (horiz ? x : y) / GRID_CELL;
+    if (k < 0) k = 0;
+    if (k >= lines) k = lines - 1;
+
+    for (; k >= 0 && k < lines; k += sign) {
+        bound = sign < 0 ? (horiz ? x : y) - (k + 1) * GRID_CELL
+                         : k * GRID_CELL - (horiz ? x : y);
+        if (best && bound > best_score)
+            break;
+        for (j = 0; j < across; j++) {
+            cell = horiz ? &scr->cells[j * gw + k] : &scr->cells[k * gw + j];
+            for (i = 0; i < cell->n; i++) {
+                c = cell->c[i];
+                if (!usable(c, from))
+                    continue;
+                f = view_frame_geom(c);
+                along = sign * (horiz ? (L(f, c) + R(f, c)) / 2 - x
+                                      : (T(f, c) + B(f, c)) / 2 - y);
+                side = horiz ? (T(f, c) + B(f, c)) / 2 - y
+                             : (L(f, c) + R(f, c)) / 2 - x;
+                if (along <= 0)
+                    continue;
+                score = along + 2 * labs(side);
+                if (!best || score < best_score) {
+                    best = c;
+                    best_score = score;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+/* Every client filed in the cells that cover the given area, and perhaps
+ * some just outside it. One that spans several of them comes up once for
+ * each, so fn should make doing it twice harmless. */
+
+void grid_each(long x0, long y0, long x1, long y1, void (*fn)(Client *))
+{
+    Cell *cell;
+    long x, y;
+    int i;
+
+    if (!scr->cells)
+        return;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > scr->desk_w) x1 = scr->desk_w;
+    if (y1 > scr->desk_h) y1 = scr->desk_h;
+    for (y = y0 / GRID_CELL; y * GRID_CELL < y1; y++) {
+        for (x = x0 / GRID_CELL; x * GRID_CELL < x1; x++) {
+            cell = &scr->cells[y * scr->gw + x];
+            for (i = 0; i < cell->n; i++)
+                fn(cell->c[i]);
+        }
+    }
+}
+
+/* Also used to start over when the desks change size, so anything still
+ * filed has to be told it isn't any more. */
+
+void grid_free(void)
+{
+    int i, j;
+
+    if (!scr->cells)
+        return;
+    for (i = 0; i < scr->gw * scr->gh; i++) {
+        for (j = 0; j < scr->cells[i].n; j++)
+            scr->cells[i].c[j]->gridded = False;
+        free(scr->cells[i].c);
+    }
+    free(scr->cells);
+    scr->cells = NULL;
+}
+
+static Bool grid_init(void)
+{
+    scr->gw = (scr->desk_w + GRID_CELL - 1) / GRID_CELL;
+    scr->gh = (scr->desk_h + GRID_CELL - 1) / GRID_CELL;
+    scr->cells = calloc(scr->gw * scr->gh, sizeof *scr->cells);
+    return scr->cells != NULL;
+}
+
+static void cell_add(Cell *cell, Client *c)
+{
+    if (cell->n == cell->size) {
+        cell->size = cell->size ? cell->size * 2 : 8;
+        cell->c = realloc(cell->c, cell->size * sizeof *cell->c);
+    }
+    cell->c[cell->n++] = c;
+}
+
+/* Order within a cell doesn't matter, so fill the hole with the last. */
+
+static void cell_del(Cell *cell, Client *c)
+{
+    int i;
+
+    for (i = 0; i < cell->n; i++) {
+        if (cell->c[i] == c) {
+            cell->c[i] = cell->c[--cell->n];
+            return;
+        }
+    }
+}
+
+static Bool usable(Client *c, Client *from)
+{
+    return c != from && c->mapped && c->decor;
+}
@@ -6,39 +6,47 @@
 #include <stdio.h>
 #include <string.h>
 #include <locale.h>
-#include <sys/wait.h>
 #include <X11/Xatom.h>
 #include <X11/cursorfont.h>
 #ifdef SHAPE
 #include <X11/extensions/shape.h>
 #endif
+#ifdef XI2
+#include <X11/extensions/XInput2.h>
+#endif
+#ifdef RANDR
+#include <X11/extensions/Xrandr.h>
+#endif
 #include "aewm.h"
 
-Window *wins, pressed = None, destroying = None;
+ScreenInfo *screens, *scr;
+int nscreens;
+Window pressed = None, destroying = None;
 XContext cli_tab, frame_tab;
-int rw, rh;
-unsigned int nwins = 0;
-unsigned long ndesks = 1;
-unsigned long cur_desk = 0;
 #ifdef SHAPE
 Bool shape;
 int shape_event;
 #endif
+#ifdef XI2
+Bool xinput;
+int xinput_op;
+#endif
+#ifdef SYNC
+Bool xsync;
+int xsync_event;
+#endif
+#ifdef RANDR
+Bool randr;
+Bool randr_monitors;
+int randr_event;
+#endif
 XFontStruct *font;
 #ifdef X_HAVE_UTF8_STRING
 XFontSet font_set;
 #endif
 #ifdef XFT
 XftFont *xftfont;
-XftColor xft_fg;
-#endif
-Colormap def_cmap;
-XColor fg;
-XColor bg;
-XColor bd;
-GC inv_gc;
-GC text_gc;
-GC bord_gc;
+#endif
 Cursor crs_move;
 Cursor crs_size;
 Cursor crs_frame;
@@ -47,20 +55,42 @@ char *opt_font = DEF_FONT;
 #ifdef XFT
 char *opt_xftfont = DEF_XFTFONT;
 #endif
-char *opt_new[] = {DEF_NEW1, DEF_NEW2, DEF_NEW3, DEF_NEW4, DEF_NEW5};
+char *opt_new[] = {DEF_NEW1, DEF_NEW2, DEF_NEW3, NULL, NULL};
 char *opt_fg = DEF_FG;
 char *opt_bg = DEF_BG;
 char *opt_bd = DEF_BD;
 int opt_bw = DEF_BW;
 int opt_pad = DEF_PAD;
 int opt_mt = DEF_MT;
+int opt_tr = DEF_TR;
+int opt_ht = DEF_HT;
+Bool opt_op = False;
+int opt_sr = DEF_SR;
+int opt_sn = DEF_SN;
+Bool opt_sp = False;
+int opt_dw = DEF_DW;
+int opt_dh = DEF_DH;
+#ifdef XFT
+Bool opt_sd = False;
+#endif
+#ifdef COMPOSITE
+Bool opt_cm = False;
+#endif
+Stats stats;
 sig_atomic_t timed_out = 0;
 sig_atomic_t killed = 0;
+sig_atomic_t stats_wanted = 0;
+sig_atomic_t children_exited = 0;
 
 static void conf_read(char *);
 static void dpy_init(void);
+static void scr_init(int num);
 static void shutdown(void);
-static Brace win_brace_get(Window w);
+static void scr_free(void);
+static void strut_apply(long *s, int n, Geom o, Brace *b);
+static void vis_init(Vis *v, Visual *visual, int depth, Colormap cmap);
+static void vis_free(Vis *v);
+static unsigned long vis_pixel(Vis *v, XColor *c);
 
 int main(int argc, char **argv)
 {
@@ -73,6 +103,10 @@ int main(int argc, char **argv)
         if ARG("font", "fn", 1) opt_font = argv[++i];
 #ifdef XFT
         else if ARG("xftfont", "fa", 1) opt_xftfont = argv[++i];
+        else if ARG("sharedraw", "sd", 0) opt_sd = True;
+#endif
+#ifdef COMPOSITE
+        else if ARG("composite", "cm", 0) opt_cm = True;
 #endif
         else if ARG("fgcolor", "fg", 1) opt_fg = argv[++i];
         else if ARG("bgcolor", "bg", 1) opt_bg = argv[++i];
@@ -80,11 +114,29 @@ int main(int argc, char **argv)
         else if ARG("bdwidth", "bw", 1) opt_bw = atoi(argv[++i]);
         else if ARG("padding", "p", 1) opt_pad = atoi(argv[++i]);
         else if ARG("maptime", "mt", 1) opt_mt = atoi(argv[++i]);
+        else if ARG("titlerate", "tr", 1) opt_tr = atoi(argv[++i]);
+        else if ARG("hidetime", "ht", 1) opt_ht = atoi(argv[++i]);
+        else if ARG("opaque", "op", 0) opt_op = True;
+        else if ARG("sweeprate", "sr", 1) opt_sr = atoi(argv[++i]);
+        else if ARG("snap", "sn", 1) opt_sn = atoi(argv[++i]);
+        else if ARG("smartplace", "sp", 0) opt_sp = True;
+        else if ARG("layout", "lo", 2) {
+            tile_layout_set(atol(argv[i + 1]), argv[i + 2]);
+            i += 2;
+        }
+        else if ARG("desksize", "ds", 2) {
+            opt_dw = atoi(argv[++i]);
+            opt_dh = atoi(argv[++i]);
+        }
         else if ARG("new1", "1", 1) opt_new[0] = argv[++i];
         else if ARG("new2", "2", 1) opt_new[1] = argv[++i];
         else if ARG("new3", "3", 1) opt_new[2] = argv[++i];
         else if ARG("new4", "4", 1) opt_new[3] = argv[++i];
         else if ARG("new5", "5", 1) opt_new[4] = argv[++i];
+        else if ARG("bind", "b", 2) {
+            bind_set(argv[i + 1], argv[i + 2]);
+            i += 2;
+        }
         else if ARG("config", "rc", 1) conf_read(argv[++i]);
         else if ARG("version", "v",0) {
             printf("aewm: version " VERSION "\n");
@@ -102,7 +154,9 @@ int main(int argc, char **argv)
     sig_set(SIGINT, sig_handle);
     sig_set(SIGHUP, sig_handle);
     sig_set(SIGCHLD, sig_handle);
+    sig_set(SIGUSR1, sig_handle);
 
+    bind_init();
     dpy_init();
     ev_loop();
     shutdown();
@@ -113,6 +167,7 @@ static void conf_read(char *rcfile)
 {
     FILE *rc;
     char buf[BUF_SIZE], token[BUF_SIZE], *p;
+    unsigned long desk;
 
     if (!(rc = rc_open(rcfile, "aewmrc"))) {
         if (rcfile) fprintf(stderr, "aewm: rc file '%s' not found\n", rcfile);
@@ -125,6 +180,10 @@ static void conf_read(char *rcfile)
             if (RC_OPT("font")) opt_font = strdup(token);
 #ifdef XFT
             else if (RC_OPT("xftfont")) opt_xftfont = strdup(token);
+            else if (RC_OPT("sharedraw")) opt_sd = atoi(token);
+#endif
+#ifdef COMPOSITE
+            else if (RC_OPT("composite")) opt_cm = atoi(token);
 #endif
             else if (RC_OPT("fgcolor")) opt_fg = strdup(token);
             else if (RC_OPT("bgcolor")) opt_bg = strdup(token);
@@ -132,11 +191,29 @@ static void conf_read(char *rcfile)
             else if (RC_OPT("bdwidth")) opt_bw = atoi(token);
             else if (RC_OPT("padding")) opt_pad = atoi(token);
             else if (RC_OPT("maptime")) opt_mt = atoi(token);
+            else if (RC_OPT("titlerate")) opt_tr = atoi(token);
+            else if (RC_OPT("hidetime")) opt_ht = atoi(token);
+            else if (RC_OPT("opaque")) opt_op = atoi(token);
+            else if (RC_OPT("sweeprate")) opt_sr = atoi(token);
+            else if (RC_OPT("snap")) opt_sn = atoi(token);
+            else if (RC_OPT("smartplace")) opt_sp = atoi(token);
+            else if (RC_OPT("layout")) {
+                desk = atol(token);
+                if (tok_next(&p, token)) tile_layout_set(desk, token);
+            }
+            else if (RC_OPT("desksize")) {
+                opt_dw = atoi(token);
+                if (tok_next(&p, token)) opt_dh = atoi(token);
+            }
             else if (RC_OPT("button1")) opt_new[0] = strdup(token);
             else if (RC_OPT("button2")) opt_new[1] = strdup(token);
             else if (RC_OPT("button3")) opt_new[2] = strdup(token);
             else if (RC_OPT("button4")) opt_new[3] = strdup(token);
             else if (RC_OPT("button5")) opt_new[4] = strdup(token);
+            else if (RC_OPT("bind")) {
+                bind_set(token, p);
+                p += strlen(p);
+            }
         }
     }
     fclose(rc);
@@ -144,20 +221,19 @@ static void conf_read(char *rcfile)
 
 static void dpy_init(void)
 {
-#ifdef X_HAVE_UTF8_STRING
-    char **missing;
-    char *def_str;
-    int nmissing;
-#endif
-    XGCValues gv;
-    XColor exact;
-    XWindowAttributes attr;
-    XSetWindowAttributes sattr;
 #ifdef SHAPE
     int shape_err;
 #endif
-    unsigned int i;
-    Client *c;
+#ifdef XI2
+    int xi_event, xi_err, xi_major = 2, xi_minor = 0;
+#endif
+#ifdef SYNC
+    int xsync_err, xsync_major, xsync_minor;
+#endif
+#ifdef RANDR
+    int randr_err, randr_major, randr_minor;
+#endif
+    int i;
 
     if (!(dpy = XOpenDisplay(NULL))) {
         fprintf(stderr, "aewm: can't open display %s\n", getenv("DISPLAY"));
@@ -165,10 +241,6 @@ static void dpy_init(void)
     }
 
     XSetErrorHandler(err_handle);
-    screen = DefaultScreen(dpy);
-    root = RootWindow(dpy, screen);
-    rw = DisplayWidth(dpy, screen);
-    rh = DisplayHeight(dpy, screen);
     pressed = None;
     cli_tab = XUniqueContext();
     frame_tab = XUniqueContext();
@@ -178,26 +250,11 @@ static void dpy_init(void)
     crs_frame = XCreateFontCursor(dpy, XC_right_ptr);
     crs_win = XCreateFontCursor(dpy, XC_left_ptr);
 
-    def_cmap = DefaultColormap(dpy, screen);
-    XAllocNamedColor(dpy, def_cmap, opt_fg, &fg, &exact);
-    XAllocNamedColor(dpy, def_cmap, opt_bg, &bg, &exact);
-    XAllocNamedColor(dpy, def_cmap, opt_bd, &bd, &exact);
-
     if (!(font = XLoadQueryFont(dpy, opt_font))) {
         fprintf(stderr, "aewm: font '%s' not found\n", opt_font);
         exit(1);
     }
-#ifdef X_HAVE_UTF8_STRING
-    font_set = XCreateFontSet(dpy, opt_font, &missing, &nmissing, &def_str);
-#endif
-
 #ifdef XFT
-    xft_fg.color.red = fg.red;
-    xft_fg.color.green = fg.green;
-    xft_fg.color.blue = fg.blue;
-    xft_fg.color.alpha = 0xffff;
-    xft_fg.pixel = fg.pixel;
-
     if (!(xftfont = XftFontOpenName(dpy, DefaultScreen(dpy), opt_xftfont))) {
         fprintf(stderr, "aewm: Xft font '%s' not found\n", opt_font);
         exit(1);
@@ -207,26 +264,27 @@ static void dpy_init(void)
 #ifdef SHAPE
     shape = XShapeQueryExtension(dpy, &shape_event, &shape_err);
 #endif
-
-    gv.function = GXcopy;
-    gv.foreground = fg.pixel;
-    gv.font = font->fid;
-    text_gc = XCreateGC(dpy, root, GCFunction|GCForeground|GCFont, &gv);
-
-    gv.foreground = bd.pixel;
-    gv.line_width = opt_bw;
-    bord_gc = XCreateGC(dpy, root, GCFunction|GCForeground|GCLineWidth, &gv);
-
-    gv.function = GXinvert;
-    gv.subwindow_mode = IncludeInferiors;
-    inv_gc = XCreateGC(dpy, root,
-        GCFunction|GCSubwindowMode|GCLineWidth|GCFont, &gv);
+#ifdef XI2
+    xinput = XQueryExtension(dpy, "XInputExtension", &xinput_op, &xi_event,
+        &xi_err) && XIQueryVersion(dpy, &xi_major, &xi_minor) == Success;
+#endif
+#ifdef SYNC
+    xsync = XSyncQueryExtension(dpy, &xsync_event, &xsync_err) &&
+        XSyncInitialize(dpy, &xsync_major, &xsync_minor);
+#endif
+#ifdef RANDR
+    randr = XRRQueryExtension(dpy, &randr_event, &randr_err) &&
+        XRRQueryVersion(dpy, &randr_major, &randr_minor) &&
+        (randr_major > 1 || randr_minor >= 3);
+    randr_monitors = randr && (randr_major > 1 || randr_minor >= 5);
+#endif
 
     utf8_string = XInternAtom(dpy, "UTF8_STRING", False);
     wm_protos = XInternAtom(dpy, "WM_PROTOCOLS", False);
     wm_delete = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
     wm_state = XInternAtom(dpy, "WM_STATE", False);
     wm_change_state = XInternAtom(dpy, "WM_CHANGE_STATE", False);
+    mwm_hints = XInternAtom(dpy, "_MOTIF_WM_HINTS", False);
     net_supported = XInternAtom(dpy, "_NET_SUPPORTED", False);
     net_cur_desk = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
     net_num_desks = XInternAtom(dpy, "_NET_NUMBER_OF_DESKTOPS", False);
@@ -241,6 +299,16 @@ static void dpy_init(void)
     net_wm_state_mv = XInternAtom(dpy, "_NET_WM_STATE_MAXIMIZED_VERT", False);
     net_wm_state_mh = XInternAtom(dpy, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
     net_wm_state_fs = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+    net_wm_sync_req = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+    net_wm_sync_counter = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER",
+        False);
+    net_wm_moveresize = XInternAtom(dpy, "_NET_WM_MOVERESIZE", False);
+    net_moveresize_window = XInternAtom(dpy, "_NET_MOVERESIZE_WINDOW", False);
+    net_frame_extents = XInternAtom(dpy, "_NET_FRAME_EXTENTS", False);
+    net_req_frame_extents = XInternAtom(dpy, "_NET_REQUEST_FRAME_EXTENTS",
+        False);
+    net_desk_geom = XInternAtom(dpy, "_NET_DESKTOP_GEOMETRY", False);
+    net_desk_viewport = XInternAtom(dpy, "_NET_DESKTOP_VIEWPORT", False);
     net_wm_strut = XInternAtom(dpy, "_NET_WM_STRUT", False);
     net_wm_strut_partial = XInternAtom(dpy, "_NET_WM_STRUT_PARTIAL", False);
     net_wm_wintype = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
@@ -250,88 +318,181 @@ static void dpy_init(void)
     net_wm_type_splash = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_SPLASH",
         False);
 
-    atom_add(root, net_supported, XA_ATOM, &net_cur_desk, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_num_desks, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_client_list, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_client_stack, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_active_window, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_close_window, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_name, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_desk, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_state, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_state_shaded, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_state_mv, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_state_mh, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_state_fs, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_strut, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_strut_partial, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_wintype, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_type_dock, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_type_menu, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_type_splash, 1);
-    atom_add(root, net_supported, XA_ATOM, &net_wm_type_desk, 1);
-
-    atom_get(root, net_num_desks, XA_CARDINAL, 0, &ndesks, 1, NULL);
-    atom_get(root, net_cur_desk, XA_CARDINAL, 0, &cur_desk, 1, NULL);
+    nscreens = ScreenCount(dpy);
+    if (!(screens = calloc(nscreens, sizeof *screens))) {
+        fprintf(stderr, "aewm: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < nscreens; i++)
+        scr_init(i);
+    scr = &screens[DefaultScreen(dpy)];
+#ifdef COMPOSITE
+    comp_init();
+#endif
+}
+
+/* Everything that has to be done again for each root, down to taking over
+ * the windows that are already there. */
+
+static void scr_init(int num)
+{
+    XGCValues gv;
+    XColor exact;
+    XWindowAttributes attr;
+    XSetWindowAttributes sattr;
+    unsigned int i;
+    Client *c;
+
+    scr = &screens[num];
+    scr->num = num;
+    scr->root = RootWindow(dpy, num);
+    scr->rw = DisplayWidth(dpy, num);
+    scr->rh = DisplayHeight(dpy, num);
+    scr->ndesks = 1;
+
+    scr->def_cmap = DefaultColormap(dpy, num);
+    XAllocNamedColor(dpy, scr->def_cmap, opt_fg, &scr->fg, &exact);
+    XAllocNamedColor(dpy, scr->def_cmap, opt_bg, &scr->bg, &exact);
+    XAllocNamedColor(dpy, scr->def_cmap, opt_bd, &scr->bd, &exact);
+
+    vis_init(&scr->def_vis, DefaultVisual(dpy, num), DefaultDepth(dpy, num),
+        scr->def_cmap);
+
+    gv.function = GXinvert;
+    gv.subwindow_mode = IncludeInferiors;
+    gv.line_width = opt_bw;
+    gv.font = font->fid;
+    scr->inv_gc = XCreateGC(dpy, scr->root,
+        GCFunction|GCSubwindowMode|GCLineWidth|GCFont, &gv);
+
+    atom_add(scr->root, net_supported, XA_ATOM, &net_cur_desk, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_num_desks, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_client_list, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_client_stack, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_active_window, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_close_window, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_name, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_desk, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_state, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_state_shaded, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_state_mv, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_state_mh, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_state_fs, 1);
+#ifdef SYNC
+    if (xsync) {
+        atom_add(scr->root, net_supported, XA_ATOM, &net_wm_sync_req, 1);
+        atom_add(scr->root, net_supported, XA_ATOM, &net_wm_sync_counter, 1);
+    }
+#endif
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_moveresize, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_moveresize_window, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_frame_extents, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_req_frame_extents, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_desk_geom, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_desk_viewport, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_strut, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_strut_partial, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_wintype, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_type_dock, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_type_menu, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_type_splash, 1);
+    atom_add(scr->root, net_supported, XA_ATOM, &net_wm_type_desk, 1);
+
+    atom_get(scr->root, net_num_desks, XA_CARDINAL, 0, &scr->ndesks, 1, NULL);
+    atom_get(scr->root, net_cur_desk, XA_CARDINAL, 0, &scr->cur_desk, 1, NULL);
+    scr->nstrut = win_strut_get(scr->root, scr->strut);
+    output_init();
+    view_init();
 
     win_list_update();
-    for (i = 0; i < nwins; i++)
-        if (XGetWindowAttributes(dpy, wins[i], &attr)
+    for (i = 0; i < scr->nwins; i++)
+        if (XGetWindowAttributes(dpy, scr->wins[i], &attr)
                 && !attr.override_redirect && attr.map_state == IsViewable)
-            cli_new(wins[i]);
-    for (i = 0; i < nwins; i++)
-        if (FIND_CTX(wins[i], cli_tab, &c))
+            cli_new(scr->wins[i]);
+    for (i = 0; i < scr->nwins; i++)
+        if (FIND_CTX(scr->wins[i], cli_tab, &c))
             cli_map(c);
     win_list_update();
 
     sattr.event_mask = SUB_MASK|ColormapChangeMask|BTN_MASK|KEY_MASK;
-    XChangeWindowAttributes(dpy, root, CWEventMask, &sattr);
+#ifdef COMPOSITE
+    sattr.event_mask |= PropertyChangeMask;
+#endif
+    XChangeWindowAttributes(dpy, scr->root, CWEventMask, &sattr);
+    keys_grab();
 }
 
 static void shutdown(void)
 {
-    Client *c;
-    unsigned int i;
+    int i;
 
-    for (i = 0; i < nwins; i++) {
-        if (FIND_CTX(wins[i], frame_tab, &c)) {
-            IF_DEBUG(cli_print(c, "<exit>"));
-            if (c->zoomed) {
-                c->geom = c->save;
-                XResizeWindow(dpy, c->win, c->geom.w, c->geom.h);
-            }
-            XMapWindow(dpy, c->win);
-            cli_free(c);
-        }
+#ifdef COMPOSITE
+    comp_free();
+#endif
+    for (i = 0; i < nscreens; i++) {
+        scr = &screens[i];
+        scr_free();
     }
+    free(screens);
 
-    XFree(wins);
+    tile_free();
+    bind_free();
     XFreeFont(dpy, font);
 #ifdef X_HAVE_UTF8_STRING
-    XFreeFontSet(dpy, font_set);
+    if (font_set) XFreeFontSet(dpy, font_set);
 #endif
 #ifdef XFT
+    title_fonts_free();
     XftFontClose(dpy, xftfont);
 #endif
     XFreeCursor(dpy, crs_move);
     XFreeCursor(dpy, crs_size);
     XFreeCursor(dpy, crs_frame);
     XFreeCursor(dpy, crs_win);
-    XFreeGC(dpy, inv_gc);
-    XFreeGC(dpy, bord_gc);
-    XFreeGC(dpy, text_gc);
-
-    XInstallColormap(dpy, DefaultColormap(dpy, screen));
     XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
 
-    XDeleteProperty(dpy, root, net_supported);
-    XDeleteProperty(dpy, root, net_client_list);
-    XDeleteProperty(dpy, root, net_client_stack);
-
     XCloseDisplay(dpy);
     exit(0);
 }
 
+/* Give back the windows on scr, and clean up after ourselves there. */
+
+static void scr_free(void)
+{
+    Client *c;
+    unsigned int i;
+
+    for (i = 0; i < scr->nwins; i++) {
+        if (FIND_TOP(scr->wins[i], &c)) {
+            IF_DEBUG(cli_print(c, "<exit>"));
+            if (c->fullscreen)
+                c->geom = c->fs_save;
+            if (c->zoomed)
+                c->geom = c->save;
+            if (c->fullscreen || c->zoomed)
+                XResizeWindow(dpy, c->win, c->geom.w, c->geom.h);
+            XMapWindow(dpy, c->win);
+            cli_free(c);
+        }
+    }
+
+    grid_free();
+    snap_free();
+    view_free();
+    free(scr->wins);
+    XFreeGC(dpy, scr->inv_gc);
+    vis_free(&scr->def_vis);
+    if (scr->argb_vis.visual) {
+        vis_free(&scr->argb_vis);
+        XFreeColormap(dpy, scr->argb_vis.cmap);
+    }
+
+    XInstallColormap(dpy, scr->def_cmap);
+    XDeleteProperty(dpy, scr->root, net_supported);
+    XDeleteProperty(dpy, scr->root, net_client_list);
+    XDeleteProperty(dpy, scr->root, net_client_stack);
+}
+
 int sig_set(int signum, void (*handler)(int))
 {
     struct sigaction act;
@@ -354,7 +515,10 @@ void sig_handle(int signum)
             killed = 1;
             break;
         case SIGCHLD:
-            wait(NULL);
+            children_exited = 1;
+            break;
+        case SIGUSR1:
+            stats_wanted = 1;
             break;
     }
 }
@@ -370,20 +534,65 @@ int err_handle(Display *dpy, XErrorEvent *e)
     return 0;
 }
 
+/* The screen a window is on, as far as we can tell without asking: a root
+ * is its own, and a client's windows are on the client's. Anything else
+ * is NULL. */
+
+ScreenInfo *scr_find(Window w)
+{
+    Client *c;
+    int i;
+
+    for (i = 0; i < nscreens; i++)
+        if (screens[i].root == w) return &screens[i];
+    if (FIND_CTX(w, frame_tab, &c) || FIND_CTX(w, cli_tab, &c))
+        return c->scr;
+    return NULL;
+}
+
+/* The frames on a desk with a viewport are in its box (see aewm_view.c),
+ * so we list them right after it, which is where they are in the stacking
+ * order as far as anyone looking at the screen is concerned. */
+
 void win_list_update(void)
 {
-    unsigned int i, j = 0;
-    Window qroot, qparent, *cwins;
+    unsigned int i, j = 0, ntop, nkids;
+    Window qroot, qparent, *top = NULL, *kids, *more, *cwins;
     Client *c;
 
-    if (wins) XFree(wins);
-    XQueryTree(dpy, root, &qroot, &qparent, &wins, &nwins);
+    free(scr->wins);
+    scr->wins = NULL;
+    scr->nwins = 0;
+    scr->wins_stale = False;
+    if (!XQueryTree(dpy, scr->root, &qroot, &qparent, &top, &ntop) ||
+            !(scr->wins = malloc(ntop * sizeof *scr->wins))) {
+        if (top) XFree(top);
+        return;
+    }
 
-    if ((cwins = malloc(nwins * sizeof *c))) {
-        for (i = 0; i < nwins; i++)
-            if (FIND_CTX(wins[i], frame_tab, &c))
+    for (i = 0; i < ntop; i++) {
+        scr->wins[scr->nwins++] = top[i];
+        if (view_is_box(top[i]) && XQueryTree(dpy, top[i], &qroot, &qparent,
+                &kids, &nkids) && kids) {
+            if ((more = realloc(scr->wins, (ntop + scr->nwins - i - 1 +
+                    nkids) * sizeof *more))) {
+                scr->wins = more;
+                memcpy(more + scr->nwins, kids, nkids * sizeof *more);
+                scr->nwins += nkids;
+            }
+            XFree(kids);
+        }
+    }
+    if (top) XFree(top);
+
+    if ((cwins = malloc(scr->nwins * sizeof *c))) {
+        for (i = 0; i < scr->nwins; i++) {
+            if (FIND_TOP(scr->wins[i], &c)) {
+                c->stack = i;
                 cwins[j++] = c->win;
-        atom_set(root, net_client_stack, XA_WINDOW, cwins, j);
+            }
+        }
+        atom_set(scr->root, net_client_stack, XA_WINDOW, cwins, j);
         free(cwins);
     }
 }
@@ -394,7 +603,8 @@ int pointer_get(long *x, long *y)
     int rx, ry, wx, wy;
     unsigned int mask;
 
-    XQueryPointer(dpy, root, &real_root, &real_w, &rx, &ry, &wx, &wy, &mask);
+    XQueryPointer(dpy, scr->root, &real_root, &real_w, &rx, &ry, &wx, &wy,
+        &mask);
     *x = rx;
     *y = ry;
     return mask;
@@ -402,68 +612,212 @@ int pointer_get(long *x, long *y)
 
 /* This is tricky in that we might be called during startup when wins points
  * to the client toplevels, which are saved in cli_tab. When we're already
- * running, wins gives us the frames. It's a bit of a hack. */
+ * running, wins gives us the frames. It's a bit of a hack.
+ *
+ * The braces are those of one output (see aewm_output.c): its edges, less
+ * whatever struts reach into it. Struts are measured from the edges of the
+ * screen, but what we return is in the desk's own coordinates, like the
+ * geometry of the clients on it. Every strut was read when its window
+ * turned up or last changed it, so this doesn't talk to the server. */
 
-Brace desk_braces_sum(unsigned long desk)
+Brace desk_braces_sum(unsigned long desk, int out)
 {
-    Brace b, tmp;
+    Geom o = scr->outputs[out];
+    Brace b;
     Client *c;
-    XWindowAttributes attr;
     unsigned int i;
 
-    b = win_brace_get(root);
-
-    for (i = 0; i < nwins; i++) {
-        if ((FIND_CTX(wins[i], frame_tab, &c) ||
-                FIND_CTX(wins[i], cli_tab, &c)) && ON_DESK(c->desk, desk)) {
-            XGetWindowAttributes(dpy, c->win, &attr);
-            if (attr.map_state == IsViewable) {
-                tmp = win_brace_get(c->win);
-                if (tmp.l && tmp.l > b.l) b.l = tmp.l;
-                if (tmp.r && tmp.r < b.r) b.r = tmp.r;
-                if (tmp.t && tmp.t > b.t) b.t = tmp.t;
-                if (tmp.b && tmp.b < b.b) b.b = tmp.b;
-            }
-        }
-    }
+    b.l = o.x;
+    b.r = o.x + o.w;
+    b.t = o.y;
+    b.b = o.y + o.h;
+    strut_apply(scr->strut, scr->nstrut, o, &b);
+
+    for (i = 0; i < scr->nwins; i++)
+        if (FIND_TOP(scr->wins[i], &c) && ON_DESK(c->desk, desk) &&
+                c->mapped && c->nstrut)
+            strut_apply(c->strut, c->nstrut, o, &b);
+    b.l += view_x(desk);
+    b.r += view_x(desk);
+    b.t += view_y(desk);
+    b.b += view_y(desk);
     return b;
 }
 
-/* Reads the _NET_WM_STRUT_PARTIAL or _NET_WM_STRUT hint and returns a
- * "brace", which is the information we really want -- coordinates for
- * each boundary, rather than distances from the screen edge.
- *
- * In the case of _NET_WM_STRUT_PARTIAL we cheat and only take the first
- * 4 values, because that's all we care about. This means we can use the
- * same code for both (_NET_WM_STRUT only specifies 4 elements). Each
- * number is the margin in pixels on that side of the display where we
- * don't want to place clients. If there is no hint, we act as if it was
- * all zeros (no margin). */
-
-static Brace win_brace_get(Window w)
+/* Reads the _NET_WM_STRUT_PARTIAL or _NET_WM_STRUT hint into s, and
+ * returns how many numbers it had (12 or 4), or 0 if there is neither.
+ * We ask for this when a client turns up and when it changes the hint,
+ * and keep the answer. */
+
+int win_strut_get(Window w, long *s)
 {
     Atom real_type;
-    int real_format = 0;
+    int real_format = 0, i, n = 0;
     unsigned long items_read = 0;
     unsigned long bytes_left = 0;
-    unsigned char *data;
-    Brace b = {0, rw, 0, rh};
+    unsigned char *data = NULL;
 
     XGetWindowProperty(dpy, w, net_wm_strut_partial, 0, 12, False,
         XA_CARDINAL, &real_type, &real_format, &items_read, &bytes_left,
         &data);
 
-    if (!(real_format == 32 && items_read >= 12))
+    if (!(real_format == 32 && items_read >= 12)) {
+        if (data) XFree(data);
+        data = NULL;
         XGetWindowProperty(dpy, w, net_wm_strut, 0, 4, False, XA_CARDINAL,
             &real_type, &real_format, &items_read, &bytes_left, &data);
+    }
 
     if (real_format == 32 && items_read >= 4) {
-        b.l = ((unsigned long *)data)[0];
-        b.r = rw - ((unsigned long *)data)[1];
-        b.t = ((unsigned long *)data)[2];
-        b.b = rh - ((unsigned long *)data)[3];
-        XFree(data);
+        n = items_read >= 12 ? 12 : 4;
+        for (i = 0; i < n; i++)
+            s[i] = ((unsigned long *)data)[i];
     }
+    if (data) XFree(data);
+    return n;
+}
 
-    return b;
+/* Narrows b, the braces of output o, to keep clear of the strut s, which
+ * has n numbers. Each of the first four is a margin in pixels on that side
+ * of the screen where we don't want to place clients; the other eight of
+ * a partial strut say how far along that side each one runs, where a
+ * plain one runs the whole length. A margin only counts on o if it
+ * reaches into o, so a panel at the bottom of one monitor doesn't take
+ * space from the one beside it. With no strut (n is 0), there's no
+ * margin. */
+
+static void strut_apply(long *s, int n, Geom o, Brace *b)
+{
+    long l[12];
+    int i;
+
+    if (!n)
+        return;
+    for (i = 0; i < 12; i++)
+        l[i] = i < n ? s[i] : 0;
+    if (n < 12) {
+        l[5] = l[7] = scr->rh - 1;
+        l[9] = l[11] = scr->rw - 1;
+    }
+    if (l[0] > o.x && l[4] < o.y + o.h && l[5] >= o.y && l[0] > b->l)
+        b->l = l[0];
+    if (scr->rw - l[1] < o.x + o.w && l[6] < o.y + o.h && l[7] >= o.y &&
+            scr->rw - l[1] < b->r)
+        b->r = scr->rw - l[1];
+    if (l[2] > o.y && l[8] < o.x + o.w && l[9] >= o.x && l[2] > b->t)
+        b->t = l[2];
+    if (scr->rh - l[3] < o.y + o.h && l[10] < o.x + o.w && l[11] >= o.x &&
+            scr->rh - l[3] < b->b)
+        b->b = scr->rh - l[3];
+}
+
+/* Pick what to draw a client's frame with. Only 32-bit TrueColor clients
+ * (that is, ARGB ones) get a frame of their own visual, with a colormap to
+ * match; anything else is happy enough being reparented into the default.
+ * In practice there's only one such visual, so we set it up the first time
+ * we need it and keep it. */
+
+Vis *vis_get(XWindowAttributes *attr)
+{
+    if (attr->depth != 32 || attr->depth == scr->def_vis.depth ||
+            attr->visual->class != TrueColor)
+        return &scr->def_vis;
+
+    if (!scr->argb_vis.visual)
+        vis_init(&scr->argb_vis, attr->visual, attr->depth,
+            XCreateColormap(dpy, scr->root, attr->visual, AllocNone));
+    return &scr->argb_vis;
+}
+
+/* GCs can only be used on drawables of the depth they were made for, so
+ * for anything but the root's depth we need a scratch pixmap to make them
+ * against. */
+
+static void vis_init(Vis *v, Visual *visual, int depth, Colormap cmap)
+{
+    XGCValues gv;
+#ifdef RENDER
+    XRenderColor xc;
+#endif
+    Drawable d = scr->root;
+
+    v->visual = visual;
+    v->depth = depth;
+    v->cmap = cmap;
+    v->fg = vis_pixel(v, &scr->fg);
+    v->bg = vis_pixel(v, &scr->bg);
+    v->bd = vis_pixel(v, &scr->bd);
+
+    if (depth != DefaultDepth(dpy, scr->num))
+        d = XCreatePixmap(dpy, scr->root, 1, 1, depth);
+
+    gv.function = GXcopy;
+    gv.foreground = v->fg;
+    gv.font = font->fid;
+    v->text_gc = XCreateGC(dpy, d, GCFunction|GCForeground|GCFont, &gv);
+
+    gv.foreground = v->bd;
+    gv.line_width = opt_bw;
+    v->bord_gc = XCreateGC(dpy, d, GCFunction|GCForeground|GCLineWidth, &gv);
+
+    if (d != scr->root)
+        XFreePixmap(dpy, d);
+
+#ifdef XFT
+    v->xft_fg.color.red = scr->fg.red;
+    v->xft_fg.color.green = scr->fg.green;
+    v->xft_fg.color.blue = scr->fg.blue;
+    v->xft_fg.color.alpha = 0xffff;
+    v->xft_fg.pixel = v->fg;
+    v->shared_draw = NULL;
+#endif
+#ifdef RENDER
+    xc.red = scr->fg.red;
+    xc.green = scr->fg.green;
+    xc.blue = scr->fg.blue;
+    xc.alpha = 0xffff;
+    v->fg_pict = XRenderCreateSolidFill(dpy, &xc);
+#endif
+}
+
+static void vis_free(Vis *v)
+{
+    XFreeGC(dpy, v->text_gc);
+    XFreeGC(dpy, v->bord_gc);
+#ifdef XFT
+    if (v->shared_draw) XftDrawDestroy(v->shared_draw);
+#endif
+#ifdef RENDER
+    XRenderFreePicture(dpy, v->fg_pict);
+#endif
+}
+
+/* The colors were allocated in the default colormap, so there the pixels
+ * are what we got back. In a TrueColor visual we can compute them from the
+ * masks instead of asking the server, with any bits not covered by a
+ * color mask (the alpha channel) all set, so the frame is opaque. */
+
+static unsigned long vis_pixel(Vis *v, XColor *c)
+{
+    unsigned long masks[3], p = 0, m;
+    unsigned short vals[3];
+    int i, shift;
+
+    if (v->visual == DefaultVisual(dpy, scr->num))
+        return c->pixel;
+
+    masks[0] = v->visual->red_mask;
+    masks[1] = v->visual->green_mask;
+    masks[2] = v->visual->blue_mask;
+    vals[0] = c->red;
+    vals[1] = c->green;
+    vals[2] = c->blue;
+
+    for (i = 0; i < 3; i++) {
+        if (!(m = masks[i])) continue;
+        for (shift = 0; !(m & 1); shift++) m >>= 1;
+        p |= (vals[i] * m / 0xffff) << shift;
+    }
+    m = v->depth < 32 ? (1UL << v->depth) - 1 : 0xffffffffUL;
+    return p | (m & ~(masks[0] | masks[1] | masks[2]));
 }
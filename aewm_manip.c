@@ -7,13 +7,58 @@
 #include <signal.h>
 #include <unistd.h>
 #include <X11/Xatom.h>
+#ifdef XI2
+#include <X11/extensions/XInput2.h>
+#endif
 #include "aewm.h"
 
 static void do_set_iconified(Client *, long);
-static void do_sweep(Client *, SweepFunc);
+static void resize_from(Client *, Brace);
+static void sweep_run(Client *, Cursor, SweepFunc, Brace);
+static void do_sweep(Client *, SweepFunc, Brace, Bool);
+static Bool sweep_grab(Cursor);
+static void sweep_ungrab(void);
+static Bool sweep_next(Bool, XEvent *);
+static Bool sweep_defer(XEvent *);
+static void sweep_compress(XEvent *);
+static Bool is_motion(XEvent *);
+#ifdef XI2
+static Bool xi_to_core(XEvent *);
+#endif
+static void sweep_update(Client *);
+static void sweep_apply(Client *, long);
+static void sweep_flush(void);
+static long sweep_wait(long);
+static void sweep_undefer(void);
+#ifdef SYNC
+static void sync_begin(Client *);
+static void sync_request(Client *, long);
+static void sync_end(void);
+#endif
 static Bool crossed(int a, int pa, int ref, int w);
 static void cli_draw_outline(Client *);
 
+#define NDEFER 32
+#define NET_MOVERESIZE_MOVE 8
+#define NET_MOVERESIZE_CANCEL 11
+#define SYNC_WAIT 250
+
+static Client *swept;
+static Geom swept_geom;
+static long swept_at;
+static Bool swept_due;
+static XEvent deferred[NDEFER];
+static int ndeferred;
+static int sweep_dev; /* XI2 master pointer we have grabbed, or 0 */
+static int sweep_button; /* must still be down when we start, if not 0 */
+#ifdef SYNC
+static XSyncCounter swept_counter;
+static XSyncAlarm swept_alarm;
+static XSyncValue swept_value;
+static Bool swept_waiting;
+static long swept_asked_at;
+#endif
+
 void cli_pressed(Client *c, int x, int y, int button)
 {
     if (x >= c->geom.w - GH(c) && y <= GH(c)) {
@@ -37,42 +82,108 @@ void cli_pressed(Client *c, int x, int y, int button)
 
 void cli_raise(Client *c)
 {
-    XRaiseWindow(dpy, c->frame);
+    cli_restack(c);
     win_list_update();
 }
 
+/*
+ * Put c on top, except that a fullscreen client stays over everything
+ * else on its output, so anything else there only goes as far as just
+ * under the lowest one. Fullscreen clients are out of their frames, on
+ * the root; a frame in a view's box (see aewm_view.c) is under them
+ * anyway. The desktop stays under the box, if there is one.
+ */
+
+void cli_restack(Client *c)
+{
+    XWindowChanges wc;
+    Client *o, *fs = NULL;
+    unsigned int i;
+    int out;
+
+    if (c->desktop && (wc.sibling = view_floor(c))) {
+        wc.stack_mode = Below;
+        XConfigureWindow(dpy, TOP(c), CWSibling|CWStackMode, &wc);
+        return;
+    }
+    if (!c->fullscreen && (!c->frame || view_parent(c) == scr->root)) {
+        out = output_of(c);
+        for (i = 0; i < scr->nwins && !fs; i++)
+            if (FIND_TOP(scr->wins[i], &o) && o != c && o->fullscreen &&
+                    o->mapped && output_of(o) == out)
+                fs = o;
+    }
+    if (fs) {
+        wc.sibling = TOP(fs);
+        wc.stack_mode = Below;
+        XConfigureWindow(dpy, TOP(c), CWSibling|CWStackMode, &wc);
+    } else {
+        XRaiseWindow(dpy, TOP(c));
+    }
+}
+
+/* Put c at the bottom, or, if it's on the root over a view's box, as far
+ * down as just over that; see aewm_view.c. */
+
 void cli_lower(Client *c)
 {
-    XLowerWindow(dpy, c->frame);
+    XWindowChanges wc;
+
+    if (!c->desktop && (wc.sibling = view_floor(c))) {
+        wc.stack_mode = Above;
+        XConfigureWindow(dpy, TOP(c), CWSibling|CWStackMode, &wc);
+    } else {
+        XLowerWindow(dpy, TOP(c));
+    }
     win_list_update();
 }
 
 void cli_show(Client *c)
 {
+    if (!c->frame && DECOR(c))
+        cli_reparent(c);
     XMapWindow(dpy, c->win);
-    XMapWindow(dpy, c->frame);
+    if (c->frame)
+        XMapWindow(dpy, c->frame);
+    c->mapped = True;
+    tile_dirty(c->desk);
 }
 
+/* We only expect an UnmapNotify if the child was actually mapped. If
+ * we've been asked to, the frame will be thrown away after a while. */
+
 void cli_hide(Client *c)
 {
-    XWindowAttributes attr;
-
-    XGetWindowAttributes(dpy, c->win, &attr);
-    c->ign_unmap = True;
-    XUnmapWindow(dpy, c->frame);
-    XUnmapWindow(dpy, c->win);
+    if (c->frame)
+        XUnmapWindow(dpy, c->frame);
+    if (c->mapped) {
+        c->ign_unmap = True;
+        XUnmapWindow(dpy, c->win);
+        c->mapped = False;
+        c->hidden_at = time_msec();
+        if (opt_ht > 0 && c->frame)
+            timer_set(cli_frames_reap, opt_ht * 1000L);
+        tile_dirty(c->desk);
+    }
 }
 
+/* A client that's about to get input had better know where it is, in
+ * case it pops something up; see view_notify. */
+
 void cli_focus(Client *c)
 {
-    atom_set(root, net_active_window, XA_WINDOW, &c->win, 1);
+    view_notify(c);
+    atom_set(c->scr->root, net_active_window, XA_WINDOW, &c->win, 1);
     XSetInputFocus(dpy, c->win, RevertToPointerRoot, CurrentTime);
     XInstallColormap(dpy, c->cmap);
 }
 
+/* A tiled client's place is the tile's (see tile_owns), so there's
+ * nothing to drag it to, and the same goes for resizing it. */
+
 void cli_move(Client *c)
 {
-    if (!c->zoomed) {
+    if (!c->zoomed && !tile_owns(c)) {
         cli_sweep(c, crs_move, calc_move);
         cli_map_apply(c);
     }
@@ -85,13 +196,52 @@ void cli_move(Client *c)
 
 void cli_resize(Client *c)
 {
+    Brace none = {0, 0, 0, 0};
+
+    resize_from(c, none);
+}
+
+/* hold says which edges are already being dragged; otherwise calc_resize
+ * waits to see which ones the pointer crosses. */
+
+static void resize_from(Client *c, Brace hold)
+{
+    if (tile_owns(c))
+        return;
     if (c->zoomed) c->save = c->geom;
     cli_shrink(c); /* FIXME */
 
-    cli_sweep(c, crs_size, calc_resize);
+    sweep_run(c, crs_size, calc_resize, hold);
     cli_map_apply(c);
 }
 
+/* A client that draws its own titlebar can ask us to move or resize it
+ * with _NET_WM_MOVERESIZE, as if it had been grabbed by the frame. dir is
+ * the edge or corner, clockwise from the top left, or NET_MOVERESIZE_MOVE,
+ * and button is the one the user pressed on it. If that's been let go by
+ * the time we have the pointer, the drag is already over, and we don't
+ * start one (see do_sweep). A cancel only means anything during the sweep
+ * (see sweep_next). We don't do the keyboard-driven kinds, and like
+ * _NET_MOVERESIZE_WINDOW, this doesn't apply to windows whose place is
+ * ours to decide. */
+
+void cli_moveresize(Client *c, long dir, long button)
+{
+    static Brace edges[] = {
+        {1, 0, 1, 0}, {0, 0, 1, 0}, {0, 1, 1, 0}, {0, 1, 0, 0},
+        {0, 1, 0, 1}, {0, 0, 0, 1}, {1, 0, 0, 1}, {1, 0, 0, 0},
+    };
+
+    if (c->fullscreen || tile_owns(c))
+        return;
+    sweep_button = button >= Button1 && button <= Button5 ? button : 0;
+    if (dir == NET_MOVERESIZE_MOVE)
+        cli_move(c);
+    else if (dir >= 0 && dir < sizeof edges / sizeof *edges)
+        resize_from(c, edges[dir]);
+    sweep_button = 0;
+}
+
 /* Transients will be iconified when their owner is iconified. */
 
 void cli_set_iconified(Client *c, long state)
@@ -100,8 +250,8 @@ void cli_set_iconified(Client *c, long state)
     unsigned int i;
 
     do_set_iconified(c, state);
-    for (i = 0; i < nwins; i++)
-        if (FIND_CTX(wins[i], frame_tab, &t) && t->trans == c->win)
+    for (i = 0; i < scr->nwins; i++)
+        if (FIND_TOP(scr->wins[i], &t) && t->trans == c->win)
             do_set_iconified(t, state);
 }
 
@@ -141,26 +291,32 @@ void cli_unshade(Client *c)
 
 void cli_grow(Client *c)
 {
-    Brace b;
-
-    if (!c->zoomed) {
+    if (!c->zoomed && !c->fullscreen) {
         atom_del(c->win, net_wm_state, XA_ATOM, net_wm_state_shaded);
         atom_add(c->win, net_wm_state, XA_ATOM, &net_wm_state_mv, 1);
         atom_add(c->win, net_wm_state, XA_ATOM, &net_wm_state_mh, 1);
         c->save = c->geom;
         c->shaded = False;
         c->zoomed = True;
-        b = desk_braces_sum(c->desk);
-        c->geom.x = b.l + BW(c);
-        c->geom.y = b.t + BW(c);
-        c->geom.w = b.r - b.l - 2 * BW(c);
-        c->geom.h = b.b - b.t - 2 * BW(c) - GH(c);
-        cli_geom_fixup(c);
+        cli_zoom_geom(c, output_of(c));
         cli_map_apply(c);
         cli_frame_redraw(c);
     }
 }
 
+/* A zoomed client fills the braces of output out. */
+
+void cli_zoom_geom(Client *c, int out)
+{
+    Brace b = desk_braces_sum(c->desk, out);
+
+    c->geom.x = b.l + BW(c);
+    c->geom.y = b.t + BW(c);
+    c->geom.w = b.r - b.l - 2 * BW(c);
+    c->geom.h = b.b - b.t - 2 * BW(c) - GH(c);
+    cli_geom_fixup(c);
+}
+
 void cli_shrink(Client *c)
 {
     if (c->zoomed) {
@@ -173,6 +329,59 @@ void cli_shrink(Client *c)
     }
 }
 
+/*
+ * A fullscreen client is taken out of its frame and put on top, at the
+ * size of its output. With no frame there's no border, grip or title to
+ * redraw, and the client gets real ConfigureNotifys from the server
+ * rather than synthetic ones from us, so once it's there, drawing to it
+ * involves nobody but the client and the server.
+ *
+ * Taking a mapped window out of its frame or putting it back unmaps it,
+ * so we have to expect that.
+ */
+
+void cli_fullscreen(Client *c)
+{
+    Geom o;
+
+    if (!c->fullscreen) {
+        atom_add(c->win, net_wm_state, XA_ATOM, &net_wm_state_fs, 1);
+        c->fs_save = c->geom;
+        c->fullscreen = True;
+        o = scr->outputs[output_of(c)];
+        c->geom.x = o.x + VX(c);
+        c->geom.y = o.y + VY(c);
+        c->geom.w = o.w;
+        c->geom.h = o.h;
+        if (c->frame) {
+            if (c->mapped) c->ign_unmap = True;
+            cli_unreparent(c);
+            XSetWindowBorderWidth(dpy, c->win, 0);
+        }
+        XSelectInput(dpy, c->win, CLI_MASK(c));
+        cli_map_apply(c);
+        cli_raise(c);
+    }
+}
+
+void cli_unfullscreen(Client *c)
+{
+    if (c->fullscreen) {
+        atom_del(c->win, net_wm_state, XA_ATOM, net_wm_state_fs);
+        c->geom = c->fs_save;
+        c->fullscreen = False;
+        XSelectInput(dpy, c->win, CLI_MASK(c));
+        if (c->mapped && DECOR(c)) {
+            c->ign_unmap = True;
+            cli_reparent(c);
+        } else {
+            XSetWindowBorderWidth(dpy, c->win, c->old_bw);
+        }
+        cli_map_apply(c);
+        cli_frame_redraw(c);
+    }
+}
+
 void cli_req_close(Client *c)
 {
     int i, n, found = 0;
@@ -189,20 +398,46 @@ void cli_req_close(Client *c)
         XKillClient(dpy, c->win);
 }
 
+/* An opaque sweep only makes sense for a window that's already up; one
+ * we're placing for the first time still gets an outline. If we're
+ * compositing, an outline on the root would be hidden under the overlay,
+ * so it goes on the overlay instead (see cli_draw_outline), and windows
+ * that are up are always swept opaquely: an outline sweep holds the
+ * server, so nothing would be repainted until it was over. */
+
 void cli_sweep(Client *c, Cursor curs, SweepFunc cb)
 {
-    XGrabServer(dpy);
-    if (XGrabPointer(dpy, root, False, MOUSE_MASK, GrabModeAsync,
-            GrabModeAsync, None, curs, CurrentTime) == GrabSuccess &&
-            XGrabKeyboard(dpy, root, False, GrabModeAsync, GrabModeAsync,
-            CurrentTime) == GrabSuccess)
+    Brace none = {0, 0, 0, 0};
+
+    sweep_run(c, curs, cb, none);
+}
+
+static void sweep_run(Client *c, Cursor curs, SweepFunc cb, Brace hold)
+{
+    Bool opaque = opt_op && c->frame && c->mapped;
+
+#ifdef COMPOSITE
+    if (comp_overlay(scr))
+        opaque = c->frame && c->mapped;
+#endif
+    if (!opaque)
+        XGrabServer(dpy);
+    if (sweep_grab(curs) && XGrabKeyboard(dpy, scr->root, False, GrabModeAsync,
+            GrabModeAsync, CurrentTime) == GrabSuccess)
     {
-        do_sweep(c, cb);
+        do_sweep(c, cb, hold, opaque);
         XUngrabKeyboard(dpy, CurrentTime);
-        XUngrabPointer(dpy, CurrentTime);
+        sweep_ungrab();
     }
-    XUngrabServer(dpy);
+    if (!opaque)
+        XUngrabServer(dpy);
 
+    timer_clear(sweep_flush);
+    swept = NULL;
+#ifdef SYNC
+    sync_end();
+#endif
+    sweep_undefer();
     alarm(0);
     timed_out = 0;
 }
@@ -214,29 +449,52 @@ void cli_sweep(Client *c, Cursor curs, SweepFunc cb)
  *
  * If that fails to return an event, it was interrupted by a signal, and
  * either we timed out or were killed. In either case, we're done.
+ *
+ * We don't ask for motion hints; they would cost a round trip to the
+ * server for every one we get. Instead, sweep_next skips ahead to the
+ * newest of any motion events already queued, so we do one calculation
+ * (and one outline) per batch the server sends us rather than per event.
+ *
+ * An opaque sweep has no outline to draw or clear; instead, each time
+ * around we hand the geometry to sweep_update, which decides when the
+ * window actually gets it.
  */
 
-static void do_sweep(Client *c, SweepFunc cb)
+static void do_sweep(Client *c, SweepFunc cb, Brace hold, Bool opaque)
 {
-    Geom orig = c->geom, motion = {0, 0, 0, 0};
-    Brace b = desk_braces_sum(c->desk), hold = {0, 0, 0, 0};
+    Geom orig = c->geom, start = c->geom, motion = {0, 0, 0, 0};
+    Brace b = desk_braces_sum(c->desk, output_of(c));
     XEvent ev;
-    long dummy_x, dummy_y;
+    int mask;
 
-    pointer_get(&motion.x, &motion.y);
+    mask = pointer_get(&motion.x, &motion.y);
+    if (sweep_button && !(mask & Button1Mask << (sweep_button - Button1)))
+        return;
+    motion.x += VX(c);
+    motion.y += VY(c);
     cb(c, &orig, &motion, &b, &hold);
 
-    for (cli_draw_outline(c); !timed_out; cli_draw_outline(c)) {
-        if (!event_get_next(MOUSE_MASK|KEY_MASK, &ev))
+    swept = c;
+    if (opaque) {
+        swept_geom = orig;
+        swept_at = 0;
+        swept_due = False;
+#ifdef SYNC
+        sync_begin(c);
+#endif
+    }
+
+    for (opaque ? sweep_update(c) : cli_draw_outline(c); !timed_out;
+            opaque ? sweep_update(c) : cli_draw_outline(c)) {
+        if (!sweep_next(opaque, &ev))
             return;
-        cli_draw_outline(c); /* clear */
+        if (!opaque)
+            cli_draw_outline(c); /* clear */
         switch (ev.type) {
             case MotionNotify:
-                motion.x += motion.w = ev.xmotion.x - motion.x;
-                motion.y += motion.h = ev.xmotion.y - motion.y;
+                motion.x += motion.w = ev.xmotion.x + VX(c) - motion.x;
+                motion.y += motion.h = ev.xmotion.y + VY(c) - motion.y;
                 cb(c, &orig, &motion, &b, &hold);
-                if (ev.xmotion.is_hint)
-                    pointer_get(&dummy_x, &dummy_y); /* trigger next hint */
                 break;
             case ButtonPress:
                 alarm(0);
@@ -261,22 +519,389 @@ static void do_sweep(Client *c, SweepFunc cb)
                 return;
             case KeyRelease:
                 return;
+            case ClientMessage: /* cancelled */
+                c->geom = start;
+                return;
         }
     }
 }
 
-/* XXX REWRITE THIS COMMENT */
+/*
+ * With XI2, we grab the client's master pointer as a device instead of
+ * grabbing the core pointer. Its motion events come in at full rate with
+ * exact root coordinates and no hints to chase, and xi_to_core dresses
+ * them up as the core events do_sweep already knows how to handle.
+ */
+
+static Bool sweep_grab(Cursor curs)
+{
+#ifdef XI2
+    unsigned char bits[XIMaskLen(XI_LASTEVENT)] = {0};
+    XIEventMask mask;
+
+    if (xinput && XIGetClientPointer(dpy, None, &sweep_dev)) {
+        XISetMask(bits, XI_Motion);
+        XISetMask(bits, XI_ButtonPress);
+        XISetMask(bits, XI_ButtonRelease);
+        mask.deviceid = sweep_dev;
+        mask.mask_len = sizeof bits;
+        mask.mask = bits;
+        if (XIGrabDevice(dpy, sweep_dev, scr->root, CurrentTime, curs,
+                GrabModeAsync, GrabModeAsync, False, &mask) == GrabSuccess)
+            return True;
+    }
+    sweep_dev = 0;
+#endif
+    return XGrabPointer(dpy, scr->root, False, MOUSE_MASK, GrabModeAsync,
+        GrabModeAsync, None, curs, CurrentTime) == GrabSuccess;
+}
+
+static void sweep_ungrab(void)
+{
+#ifdef XI2
+    if (sweep_dev) {
+        XIUngrabDevice(dpy, sweep_dev, CurrentTime);
+        sweep_dev = 0;
+        return;
+    }
+#endif
+    XUngrabPointer(dpy, CurrentTime);
+}
+
+/*
+ * Without the server grab, everyone else carries on while we have the
+ * pointer, and we have to keep up with them: an opaque sweep still wants
+ * its frames exposed, titles updated and (if we're compositing) the screen
+ * repainted. Anything that could unmap, destroy, or otherwise pull a window
+ * out from under the sweep waits until we're done, though, and so does the
+ * swept client asking to be moved or resized, which would only fight the
+ * pointer. If more of that piles up than we have room for, we finish the
+ * sweep early rather than lose any of it. The one message we do act on
+ * is the swept client cancelling its _NET_WM_MOVERESIZE, which do_sweep
+ * takes as the end of the sweep, back where it started. (With the server
+ * grabbed, no client could send it.)
+ *
+ * XI2 events can't be picked out by mask, so a sweep that grabbed a device
+ * has to go through the whole queue too. If the server is grabbed as well,
+ * we're drawing outlines and don't want anything else drawn under them, so
+ * then everything else waits.
+ */
+
+static Bool sweep_next(Bool opaque, XEvent *ev)
+{
+    if (!opaque && !sweep_dev) {
+        if (!event_get_next(MOUSE_MASK|KEY_MASK, ev))
+            return False;
+        sweep_compress(ev);
+        return True;
+    }
+
+    while (event_get_next(NoEventMask, ev)) {
+        switch (ev->type) {
+            case MotionNotify: case ButtonPress: case ButtonRelease:
+            case KeyPress: case KeyRelease:
+                sweep_compress(ev);
+                return True;
+            case ClientMessage:
+                if (ev->xclient.window == swept->win &&
+                        ev->xclient.message_type == net_wm_moveresize &&
+                        ev->xclient.data.l[2] == NET_MOVERESIZE_CANCEL)
+                    return True;
+                if (!sweep_defer(ev))
+                    return False;
+                break;
+            case MapRequest: case UnmapNotify: case DestroyNotify:
+            case CirculateRequest: case EnterNotify:
+                if (!sweep_defer(ev))
+                    return False;
+                break;
+            default:
+#ifdef XI2
+                if (sweep_dev && ev->type == GenericEvent &&
+                        ev->xcookie.extension == xinput_op) {
+                    sweep_compress(ev);
+                    if (xi_to_core(ev))
+                        return True;
+                    break;
+                }
+#endif
+                if (opaque && !(ev->type == ConfigureRequest &&
+                        ev->xconfigurerequest.window == swept->win))
+                    ev_dispatch(ev);
+                else if (!sweep_defer(ev))
+                    return False;
+                break;
+        }
+    }
+    return False;
+}
+
+static Bool sweep_defer(XEvent *ev)
+{
+    if (ndeferred == NDEFER) {
+        XPutBackEvent(dpy, ev);
+        return False;
+    }
+    deferred[ndeferred++] = *ev;
+    return True;
+}
+
+/* Only a run at the front of the queue, so nothing gets reordered. */
+
+static void sweep_compress(XEvent *ev)
+{
+    XEvent next;
+
+    while (is_motion(ev) && XEventsQueued(dpy, QueuedAfterReading)) {
+        XPeekEvent(dpy, &next);
+        if (!is_motion(&next))
+            break;
+        XNextEvent(dpy, ev);
+        stats.motion_merged++;
+    }
+}
+
+static Bool is_motion(XEvent *ev)
+{
+#ifdef XI2
+    if (ev->type == GenericEvent)
+        return sweep_dev && ev->xcookie.extension == xinput_op &&
+            ev->xcookie.evtype == XI_Motion;
+#endif
+    return ev->type == MotionNotify;
+}
+
+#ifdef XI2
+static Bool xi_to_core(XEvent *ev)
+{
+    XIDeviceEvent *de;
+    XEvent core;
+
+    if (!XGetEventData(dpy, &ev->xcookie))
+        return False;
+    de = ev->xcookie.data;
+    memset(&core, 0, sizeof core);
+    switch (de->evtype) {
+        case XI_Motion:
+            core.type = MotionNotify;
+            core.xmotion.x = de->root_x;
+            core.xmotion.y = de->root_y;
+            break;
+        case XI_ButtonPress:
+        case XI_ButtonRelease:
+            core.type = de->evtype == XI_ButtonPress ?
+                ButtonPress : ButtonRelease;
+            core.xbutton.x = de->root_x;
+            core.xbutton.y = de->root_y;
+            core.xbutton.button = de->detail;
+            break;
+    }
+    XFreeEventData(dpy, &ev->xcookie);
+    if (!core.type)
+        return False;
+    *ev = core;
+    return True;
+}
+#endif
+
+/* XPutBackEvent pushes onto the front of the queue, so go backwards. */
+
+static void sweep_undefer(void)
+{
+    while (ndeferred > 0)
+        XPutBackEvent(dpy, &deferred[--ndeferred]);
+}
+
+/* The same pacing as title_update: the first change after a quiet spell
+ * goes out right away, and anything sooner than 1/opt_sr of a second
+ * after the last one waits for a timer, by which point the pointer may
+ * well have moved on again. Either way only the latest geometry is sent.
+ * Unless the client has promised to tell us when it's done drawing (see
+ * sync_begin), we never wait on it, so a slow one can lag behind in its
+ * own drawing but not hold up the frame. */
+
+static void sweep_update(Client *c)
+{
+    long now = time_msec(), wait;
+
+    if (c->geom.x == swept_geom.x && c->geom.y == swept_geom.y &&
+            c->geom.w == swept_geom.w && c->geom.h == swept_geom.h)
+        return;
+
+    if (!(wait = sweep_wait(now))) {
+        sweep_apply(c, now);
+    } else {
+        if (swept_due)
+            stats.sweep_merged++;
+        swept_due = True;
+        timer_set(sweep_flush, wait);
+    }
+}
+
+/* How long until we can send the next geometry, or 0 if we can now. */
+
+static long sweep_wait(long now)
+{
+    long gap = opt_sr > 0 ? 1000 / opt_sr : 0;
+    long wait = swept_at + gap - now;
+
+#ifdef SYNC
+    if (swept_waiting) {
+        if (now - swept_asked_at < SYNC_WAIT) {
+            if (swept_asked_at + SYNC_WAIT - now > wait)
+                wait = swept_asked_at + SYNC_WAIT - now;
+        } else {
+            swept_waiting = False;
+            stats.sync_timeouts++;
+        }
+    }
+#endif
+    return wait > 0 ? wait : 0;
+}
+
+static void sweep_apply(Client *c, long now)
+{
+#ifdef SYNC
+    if (swept_counter &&
+            (c->geom.w != swept_geom.w || c->geom.h != swept_geom.h))
+        sync_request(c, now);
+#endif
+    cli_geom_apply(c, swept_geom);
+
+    swept_geom = c->geom;
+    swept_at = now;
+    swept_due = False;
+    stats.sweep_applied++;
+}
+
+/* Sets itself again if it's still too soon, since whatever we're waiting
+ * for may have pushed the time back since the timer was set. */
+
+static void sweep_flush(void)
+{
+    long now = time_msec(), wait;
+
+    if (swept && swept_due) {
+        scr = swept->scr;
+        if (!(wait = sweep_wait(now)))
+            sweep_apply(swept, now);
+        else
+            timer_set(sweep_flush, wait);
+    }
+}
+
+#ifdef SYNC
+/*
+ * A client that lists _NET_WM_SYNC_REQUEST in WM_PROTOCOLS keeps an XSync
+ * counter, and will set it to whatever number we send along with a resize
+ * once it has finished drawing at the new size. We put an alarm on that
+ * counter for as long as the sweep lasts, and don't resize it again until
+ * the alarm goes off (or SYNC_WAIT passes, in case it never does). Moves
+ * don't need it; nothing there for the client to redraw.
+ *
+ * Outlines aren't paced this way, because the client isn't configured at
+ * all until the sweep is over.
+ */
+
+static void sync_begin(Client *c)
+{
+    XSyncAlarmAttributes aa;
+    unsigned long counter;
+    Atom *protocols;
+    int i, n, found = 0;
+
+    swept_counter = None;
+    swept_waiting = False;
+    if (!xsync)
+        return;
+
+    if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
+        for (i=0; i<n; i++) if (protocols[i] == net_wm_sync_req) found++;
+        XFree(protocols);
+    }
+    if (!found || !atom_get(c->win, net_wm_sync_counter, XA_CARDINAL, 0,
+            &counter, 1, NULL) || !XSyncQueryCounter(dpy, counter,
+            &swept_value))
+        return;
+
+    swept_counter = counter;
+    aa.trigger.counter = swept_counter;
+    aa.trigger.value_type = XSyncAbsolute;
+    aa.trigger.wait_value = swept_value;
+    aa.trigger.test_type = XSyncPositiveComparison;
+    aa.events = True;
+    swept_alarm = XSyncCreateAlarm(dpy, XSyncCACounter|XSyncCAValueType|
+        XSyncCAValue|XSyncCATestType|XSyncCAEvents, &aa);
+}
+
+static void sync_request(Client *c, long now)
+{
+    XClientMessageEvent e;
+    XSyncAlarmAttributes aa;
+    XSyncValue one;
+    int overflow;
+
+    XSyncIntToValue(&one, 1);
+    XSyncValueAdd(&swept_value, swept_value, one, &overflow);
+
+    e.type = ClientMessage;
+    e.window = c->win;
+    e.message_type = wm_protos;
+    e.format = 32;
+    e.data.l[0] = net_wm_sync_req;
+    e.data.l[1] = CurrentTime;
+    e.data.l[2] = XSyncValueLow32(swept_value);
+    e.data.l[3] = XSyncValueHigh32(swept_value);
+    e.data.l[4] = 0;
+    XSendEvent(dpy, c->win, False, NoEventMask, (XEvent *)&e);
+
+    /* Changing the alarm also makes it active again after it went off. */
+    aa.trigger.wait_value = swept_value;
+    XSyncChangeAlarm(dpy, swept_alarm, XSyncCAValue, &aa);
+
+    swept_waiting = True;
+    swept_asked_at = now;
+    stats.sync_requests++;
+}
+
+/* The alarm may go off for a value we've already stopped waiting for. */
+
+void cli_sync_alarm(XSyncAlarmNotifyEvent *e)
+{
+    if (swept_counter && e->alarm == swept_alarm && swept_waiting &&
+            !XSyncValueLessThan(e->counter_value, swept_value)) {
+        swept_waiting = False;
+        sweep_flush();
+    }
+}
+
+static void sync_end(void)
+{
+    if (swept_counter) {
+        XSyncDestroyAlarm(dpy, swept_alarm);
+        swept_counter = None;
+    }
+    swept_waiting = False;
+}
+#endif
+
+/* Follow the pointer as long as it was over the frame. We keep track of
+ * where the window would be in orig, and snap from there each time; if we
+ * moved the snapped geometry, it would never come unstuck. */
 
 void calc_move(Client *c, Geom *orig, Geom *m, Brace *b, Brace *h)
 {
-    Geom f = cli_frame_geom(c, c->geom);
+    Geom f = cli_frame_geom(c, *orig);
     int px = m->x - m->w;
     int py = m->y - m->h;
 
     if (px > L(f, c) && px < R(f, c) && py > T(f, c) && py < B(f, c)) {
-        c->geom.x += m->w;
-        c->geom.y += m->h;
+        orig->x += m->w;
+        orig->y += m->h;
     }
+    c->geom.x = orig->x;
+    c->geom.y = orig->y;
+    snap_move(c, b);
 }
 
 static Bool crossed(int a, int pa, int ref, int w)
@@ -289,21 +914,24 @@ void calc_resize(Client *c, Geom *orig, Geom *m, Brace *b, Brace *h)
     Geom f = cli_frame_geom(c, *orig);
     int px = m->x - m->w;
     int py = m->y - m->h;
+    long vx = VX(c), vy = VY(c);
 
     if (m->w == 0 && m->h == 0)
         return;
 
-    if (crossed(m->x, px, L(f, c), BW(c)) || (m->x == 0)) {
+    if (crossed(m->x, px, L(f, c), BW(c)) || (m->x == vx)) {
         h->l = 1;
         h->r = 0;
-    } else if (crossed(m->x, px, R(f, c) - BW(c), BW(c)) || (m->x == rw-1)) {
+    } else if (crossed(m->x, px, R(f, c) - BW(c), BW(c)) ||
+            (m->x == vx + scr->rw-1)) {
         h->l = 0;
         h->r = 1;
     }
-    if (crossed(m->y, py, T(f, c), BW(c)) || (m->y == 0)) {
+    if (crossed(m->y, py, T(f, c), BW(c)) || (m->y == vy)) {
         h->t = 1;
         h->b = 0;
-    } else if (crossed(m->y, py, B(f, c) - BW(c), BW(c)) || (m->y == rh-1)) {
+    } else if (crossed(m->y, py, B(f, c) - BW(c), BW(c)) ||
+            (m->y == vy + scr->rh-1)) {
         h->t = 0;
         h->b = 1;
     }
@@ -336,20 +964,27 @@ void calc_resize(Client *c, Geom *orig, Geom *m, Brace *b, Brace *h)
 static void cli_draw_outline(Client *c)
 {
     Geom adj, f = cli_frame_geom(c, c->geom);
+    Window on = scr->root;
     char buf[BUF_SMALL];
     int len;
 
-    XDrawRectangle(dpy, root, inv_gc, f.x + BW(c)/2, f.y + BW(c)/2,
+#ifdef COMPOSITE
+    if (comp_overlay(scr))
+        on = comp_overlay(scr);
+#endif
+    f.x -= VX(c);
+    f.y -= VY(c);
+    XDrawRectangle(dpy, on, scr->inv_gc, f.x + BW(c)/2, f.y + BW(c)/2,
         f.w + BW(c), f.h + BW(c));
     if (!c->shaded)
-        XDrawLine(dpy, root, inv_gc,
+        XDrawLine(dpy, on, scr->inv_gc,
             L(f, c) + BW(c), T(f, c) + GH(c) + BW(c)/2,
             R(f, c) - BW(c), T(f, c) + GH(c) + BW(c)/2);
 
     adj = cli_geom_fixup(c);
     len = snprintf(buf, sizeof buf, "%ldx%ld%+ld%+ld", adj.w, adj.h,
         c->geom.x, c->geom.y);
-    XDrawString(dpy, root, inv_gc,
+    XDrawString(dpy, on, scr->inv_gc,
         R(f, c) - opt_pad - font->descent/2 - XTextWidth(font, buf, len),
         B(f, c) - BW(c) - opt_pad - font->descent, buf, len);
 }
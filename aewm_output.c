@@ -0,0 +1,289 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <string.h>
+#include "aewm.h"
+#ifdef RANDR
+#include <X11/extensions/Xrandr.h>
+#if RANDR_MAJOR > 1 || RANDR_MINOR >= 5
+#define RANDR_MONITORS
+#endif
+#endif
+
+/*
+ * The monitors, or outputs, that make up the screen. Without RandR there's
+ * just the one, the size of the screen. With RandR 1.5, each monitor the
+ * server lists is an output, which takes in those made up with "xrandr
+ * --setmonitor" (the only way to have more than one on Xvfb). Before
+ * that, each CRTC that is showing something is an output. Either way,
+ * two that show the same part of the screen count once.
+ *
+ * Zooming, fullscreen, tiling and placement each keep to one output,
+ * rather than straddling the gap between two, and a strut only takes
+ * space from the outputs it reaches into (see desk_braces_sum).
+ *
+ * Outputs are in root coordinates. A client is on whichever one has the
+ * middle of its frame, or the nearest one if that's in none of them.
+ *
+ * When the outputs change, we don't start over: the clients on outputs
+ * that are still there, just as they were, stay put, and only the ones
+ * on outputs that moved, changed size or went away are fitted onto
+ * whatever has replaced them.
+ */
+
+static int output_query(Geom *list);
+static int output_in(Geom *list, int n, long x, long y);
+#ifdef RANDR
+static int output_add(Geom *list, int n, long x, long y, long w, long h);
+static Bool output_kept(Geom o);
+static int output_nearest(Geom o);
+static void output_refit(Client *c, Geom from, int to);
+#endif
+
+void output_init(void)
+{
+#ifdef RANDR
+    if (randr)
+        XRRSelectInput(dpy, scr->root, RRScreenChangeNotifyMask);
+#endif
+    scr->noutputs = output_query(scr->outputs);
+}
+
+/* The output at (x, y) on the root. */
+
+int output_at(long x, long y)
+{
+    return output_in(scr->outputs, scr->noutputs, x, y);
+}
+
+int output_of(Client *c)
+{
+    Geom f = cli_frame_geom(c, c->geom);
+
+    return output_at((L(f, c) + R(f, c)) / 2 - VX(c),
+        (T(f, c) + B(f, c)) / 2 - VY(c));
+}
+
+/* The output the pointer is on. With only one, there's no need to ask. */
+
+int output_pointer(void)
+{
+    long x, y;
+
+    if (scr->noutputs == 1)
+        return 0;
+    pointer_get(&x, &y);
+    return output_at(x, y);
+}
+
+#ifdef RANDR
+/*
+ * Someone has plugged in, unplugged, moved or rotated a monitor. The
+ * screen may have changed size too, in which case the grid is the wrong
+ * size for the desks and everything has to be filed again, and the
+ * compositor's back buffer has to be made again and repainted; otherwise
+ * only what we move is.
+ */
+
+void output_changed(XEvent *e)
+{
+    Geom old[MAX_OUTPUTS], f;
+    int nold = scr->noutputs, from;
+    int ow = scr->rw, oh = scr->rh;
+    unsigned int i;
+    Client *c;
+
+    memcpy(old, scr->outputs, sizeof old);
+    XRRUpdateConfiguration(e);
+    scr->rw = DisplayWidth(dpy, scr->num);
+    scr->rh = DisplayHeight(dpy, scr->num);
+    scr->noutputs = output_query(scr->outputs);
+    stats.output_changes++;
+
+    if (scr->rw != ow || scr->rh != oh) {
+        view_resize();
+        grid_free();
+#ifdef COMPOSITE
+        comp_resize(scr);
+#endif
+    }
+
+    for (i = 0; i < scr->nwins; i++) {
+        if (!FIND_TOP(scr->wins[i], &c))
+            continue;
+        f = cli_frame_geom(c, c->geom);
+        from = output_in(old, nold, (L(f, c) + R(f, c)) / 2 - VX(c),
+            (T(f, c) + B(f, c)) / 2 - VY(c));
+        if (!output_kept(old[from]))
+            output_refit(c, old[from], output_nearest(old[from]));
+        else if (scr->rw != ow || scr->rh != oh)
+            cli_index(c);
+    }
+}
+
+static Bool output_kept(Geom o)
+{
+    int i;
+
+    for (i = 0; i < scr->noutputs; i++)
+        if (scr->outputs[i].x == o.x && scr->outputs[i].y == o.y &&
+                scr->outputs[i].w == o.w && scr->outputs[i].h == o.h)
+            return True;
+    return False;
+}
+
+/* The output that now covers most of where o was, or the first one if
+ * nothing does. */
+
+static int output_nearest(Geom o)
+{
+    long w, h, area, best_area = 0;
+    int i, best = 0;
+
+    for (i = 0; i < scr->noutputs; i++) {
+        w = (o.x + o.w < scr->outputs[i].x + scr->outputs[i].w ?
+            o.x + o.w : scr->outputs[i].x + scr->outputs[i].w) -
+            (o.x > scr->outputs[i].x ? o.x : scr->outputs[i].x);
+        h = (o.y + o.h < scr->outputs[i].y + scr->outputs[i].h ?
+            o.y + o.h : scr->outputs[i].y + scr->outputs[i].h) -
+            (o.y > scr->outputs[i].y ? o.y : scr->outputs[i].y);
+        area = w > 0 && h > 0 ? w * h : 0;
+        if (area > best_area) {
+            best = i;
+            best_area = area;
+        }
+    }
+    return best;
+}
+
+/* Move c from output from to output to, keeping it at the same place
+ * relative to the output's top left corner, and fit it inside that output.
+ * Zoomed and fullscreen clients fill the new one instead; what they'll go
+ * back to is moved along with them. */
+
+static void output_refit(Client *c, Geom from, int to)
+{
+    Geom old = c->geom, o = scr->outputs[to];
+    long dx, dy;
+
+    dx = o.x - from.x;
+    dy = o.y - from.y;
+
+    if (c->fullscreen) {
+        c->fs_save.x += dx;
+        c->fs_save.y += dy;
+        c->geom.x = o.x + VX(c);
+        c->geom.y = o.y + VY(c);
+        c->geom.w = o.w;
+        c->geom.h = o.h;
+    } else if (c->zoomed) {
+        c->save.x += dx;
+        c->save.y += dy;
+        cli_zoom_geom(c, to);
+    } else {
+        c->geom.x += dx;
+        c->geom.y += dy;
+        if (c->decor)
+            cli_geom_clamp(c, desk_braces_sum(c->desk, to));
+    }
+
+    if (c->frame)
+        cli_geom_apply(c, old);
+    else
+        cli_map_apply(c);
+    tile_dirty(c->desk);
+    stats.output_refits++;
+}
+#endif
+
+/* Fills in list and returns how many there are: always at least one, even
+ * if RandR has nothing lit up for us, and no more than MAX_OUTPUTS. */
+
+static int output_query(Geom *list)
+{
+    int n = 0;
+#ifdef RANDR
+    XRRScreenResources *res;
+    XRRCrtcInfo *ci;
+#ifdef RANDR_MONITORS
+    XRRMonitorInfo *mon;
+    int nmon;
+#endif
+    int i;
+
+#ifdef RANDR_MONITORS
+    if (randr_monitors &&
+            (mon = XRRGetMonitors(dpy, scr->root, True, &nmon))) {
+        for (i = 0; i < nmon; i++)
+            n = output_add(list, n, mon[i].x, mon[i].y, mon[i].width,
+                mon[i].height);
+        XRRFreeMonitors(mon);
+    }
+#endif
+    if (n == 0 && randr &&
+            (res = XRRGetScreenResourcesCurrent(dpy, scr->root))) {
+        for (i = 0; i < res->ncrtc; i++) {
+            if (!(ci = XRRGetCrtcInfo(dpy, res, res->crtcs[i])))
+                continue;
+            if (ci->mode != None && ci->noutput > 0)
+                n = output_add(list, n, ci->x, ci->y, ci->width, ci->height);
+            XRRFreeCrtcInfo(ci);
+        }
+        XRRFreeScreenResources(res);
+    }
+#endif
+    if (n == 0) {
+        list[0].x = 0;
+        list[0].y = 0;
+        list[0].w = scr->rw;
+        list[0].h = scr->rh;
+        n = 1;
+    }
+    return n;
+}
+
+#ifdef RANDR
+/* Add an output to the list, unless it's already there, there's no room
+ * for it, or there's nothing to it. Returns how many there are now. */
+
+static int output_add(Geom *list, int n, long x, long y, long w, long h)
+{
+    int i;
+
+    if (n == MAX_OUTPUTS || w <= 0 || h <= 0)
+        return n;
+    for (i = 0; i < n; i++)
+        if (list[i].x == x && list[i].y == y && list[i].w == w &&
+                list[i].h == h)
+            return n;
+    list[n].x = x;
+    list[n].y = y;
+    list[n].w = w;
+    list[n].h = h;
+    return n + 1;
+}
+#endif
+
+/* The one in the list that has (x, y), or failing that, the nearest. */
+
+static int output_in(Geom *list, int n, long x, long y)
+{
+    long dx, dy, d, best_d = 0;
+    int i, best = 0;
+
+    for (i = 0; i < n; i++) {
+        dx = x < list[i].x ? list[i].x - x :
+            x >= list[i].x + list[i].w ? x - list[i].x - list[i].w + 1 : 0;
+        dy = y < list[i].y ? list[i].y - y :
+            y >= list[i].y + list[i].h ? y - list[i].y - list[i].h + 1 : 0;
+        if (!dx && !dy)
+            return i;
+        d = dx + dy;
+        if (i == 0 || d < best_d) {
+            best = i;
+            best_d = d;
+        }
+    }
+    return best;
+}
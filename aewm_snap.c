@@ -0,0 +1,283 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "aewm.h"
+
+/*
+ * With opt_sn, a window being moved sticks to the edges of the screen, the
+ * braces, and other frames when it comes within that many pixels of them.
+ *
+ * Checking every other frame on each motion event would be a scan of the
+ * whole client list per event, so instead we keep the frames' edges in a
+ * sorted array per desk (and screen), one for vertical edges (by x) and
+ * one for horizontal edges (by y). Each edge also remembers how far it
+ * runs along the other axis, so that frames which merely line up from
+ * across the screen don't count. Looking for something to snap to is then
+ * a binary search for the first edge in range and a short walk from there.
+ *
+ * A client's edges are moved whenever we change its geometry (snap_index)
+ * and dropped when it goes away (snap_remove). We remember where we put
+ * them, so each is found again by binary search, and moving one only
+ * shifts the edges between its old and new place -- for a window being
+ * dragged, usually none at all. We don't bother when it's hidden: those
+ * edges are just skipped when we look. Like the grid, it all goes by the
+ * current desk's coordinates.
+ */
+
+typedef struct {
+    long pos;       /* x of a vertical edge, y of a horizontal one */
+    long lo, hi;    /* how far it runs along the other axis */
+    Client *c;
+} Edge;
+
+typedef struct EdgeSet {
+    unsigned long desk;
+    Edge *e[2];     /* [0] is vertical edges, [1] horizontal */
+    int n[2], size[2];
+} EdgeSet;
+
+static EdgeSet *edge_set(ScreenInfo *on, unsigned long desk, Bool create);
+static void edge_add(EdgeSet *s, int axis, long pos, long lo, long hi,
+    Client *c);
+static void edge_move(EdgeSet *s, int axis, long from, long pos, long lo,
+    long hi, Client *c);
+static void edge_del(EdgeSet *s, int axis, long pos, Client *c);
+static int edge_of(EdgeSet *s, int axis, long pos, Client *c);
+static int edge_find(EdgeSet *s, int axis, long pos);
+static void edge_nearest(EdgeSet *s, int axis, Client *c, long at,
+    long lo, long hi, long *best);
+static void edge_try(long to, long at, long *best);
+
+void snap_index(Client *c)
+{
+    Geom f;
+    EdgeSet *s;
+    long *at = c->indexed_at, l, r, t, b;
+
+    if (opt_sn <= 0 || (c->indexed && c->indexed_desk != c->desk))
+        snap_remove(c);
+    if (opt_sn <= 0)
+        return;
+
+    f = view_frame_geom(c);
+    l = L(f, c);
+    r = R(f, c);
+    t = T(f, c);
+    b = B(f, c);
+    s = edge_set(c->scr, c->desk, True);
+    if (c->indexed) {
+        edge_move(s, 0, at[0], l, t, b, c);
+        edge_move(s, 0, at[1], r, t, b, c);
+        edge_move(s, 1, at[2], t, l, r, c);
+        edge_move(s, 1, at[3], b, l, r, c);
+    } else {
+        edge_add(s, 0, l, t, b, c);
+        edge_add(s, 0, r, t, b, c);
+        edge_add(s, 1, t, l, r, c);
+        edge_add(s, 1, b, l, r, c);
+    }
+    at[0] = l;
+    at[1] = r;
+    at[2] = t;
+    at[3] = b;
+    c->indexed = True;
+    c->indexed_desk = c->desk;
+}
+
+void snap_remove(Client *c)
+{
+    EdgeSet *s;
+    long *at = c->indexed_at;
+
+    if (!c->indexed)
+        return;
+    if ((s = edge_set(c->scr, c->indexed_desk, False))) {
+        edge_del(s, 0, at[0], c);
+        edge_del(s, 0, at[1], c);
+        edge_del(s, 1, at[2], c);
+        edge_del(s, 1, at[3], c);
+    }
+    c->indexed = False;
+}
+
+/* Moves c->geom onto the nearest edge within opt_sn, if any, on each axis
+ * separately. b is the braces for the client's desk. */
+
+void snap_move(Client *c, Brace *b)
+{
+    Geom f = view_frame_geom(c);
+    long l = L(f, c), r = R(f, c), t = T(f, c), bo = B(f, c);
+    long dx = opt_sn + 1, dy = opt_sn + 1, ox, oy;
+    long vx = view_x(scr->cur_desk), vy = view_y(scr->cur_desk);
+    EdgeSet *s;
+    int i;
+
+    if (opt_sn <= 0)
+        return;
+
+    view_offset(c, &ox, &oy);
+    edge_try(vx, l, &dx);
+    edge_try(b->l + ox, l, &dx);
+    edge_try(vx + scr->rw, r, &dx);
+    edge_try(b->r + ox, r, &dx);
+    edge_try(vy, t, &dy);
+    edge_try(b->t + oy, t, &dy);
+    edge_try(vy + scr->rh, bo, &dy);
+    edge_try(b->b + oy, bo, &dy);
+
+    for (i = 0; i < 2; i++) {
+        if ((s = edge_set(c->scr, i ? DESK_ALL : scr->cur_desk, False))) {
+            edge_nearest(s, 0, c, l, t, bo, &dx);
+            edge_nearest(s, 0, c, r, t, bo, &dx);
+            edge_nearest(s, 1, c, t, l, r, &dy);
+            edge_nearest(s, 1, c, bo, l, r, &dy);
+        }
+    }
+
+    if (dx <= opt_sn && dx >= -opt_sn) c->geom.x += dx;
+    if (dy <= opt_sn && dy >= -opt_sn) c->geom.y += dy;
+}
+
+void snap_free(void)
+{
+    EdgeSet *sets = scr->edge_sets;
+    int i;
+
+    for (i = 0; i < scr->nedge_sets; i++) {
+        free(sets[i].e[0]);
+        free(sets[i].e[1]);
+    }
+    free(sets);
+    scr->edge_sets = NULL;
+    scr->nedge_sets = 0;
+}
+
+/* There are only ever a handful of desks, so these are just a list. */
+
+static EdgeSet *edge_set(ScreenInfo *on, unsigned long desk, Bool create)
+{
+    EdgeSet *sets = on->edge_sets;
+    int i, n = on->nedge_sets;
+
+    for (i = 0; i < n; i++)
+        if (sets[i].desk == desk) return &sets[i];
+    if (!create)
+        return NULL;
+
+    sets = on->edge_sets = realloc(sets, (n + 1) * sizeof *sets);
+    memset(&sets[n], 0, sizeof *sets);
+    sets[n].desk = desk;
+    on->nedge_sets++;
+    return &sets[n];
+}
+
+static void edge_add(EdgeSet *s, int axis, long pos, long lo, long hi,
+    Client *c)
+{
+    int i = edge_find(s, axis, pos);
+
+    if (s->n[axis] == s->size[axis]) {
+        s->size[axis] = s->size[axis] ? s->size[axis] * 2 : 64;
+        s->e[axis] = realloc(s->e[axis], s->size[axis] * sizeof(Edge));
+    }
+    memmove(&s->e[axis][i + 1], &s->e[axis][i],
+        (s->n[axis] - i) * sizeof(Edge));
+    s->e[axis][i].pos = pos;
+    s->e[axis][i].lo = lo;
+    s->e[axis][i].hi = hi;
+    s->e[axis][i].c = c;
+    s->n[axis]++;
+}
+
+/* Take c's edge at from and put it at pos, shifting only what's in
+ * between. */
+
+static void edge_move(EdgeSet *s, int axis, long from, long pos, long lo,
+    long hi, Client *c)
+{
+    Edge *e = s->e[axis];
+    int i = edge_of(s, axis, from, c), j;
+
+    if (i < 0) {
+        edge_add(s, axis, pos, lo, hi, c);
+        return;
+    }
+    if (pos < from) {
+        j = edge_find(s, axis, pos);
+        memmove(&e[j + 1], &e[j], (i - j) * sizeof(Edge));
+    } else if (pos > from) {
+        j = edge_find(s, axis, pos) - 1;
+        memmove(&e[i], &e[i + 1], (j - i) * sizeof(Edge));
+    } else {
+        j = i;
+    }
+    e[j].pos = pos;
+    e[j].lo = lo;
+    e[j].hi = hi;
+    e[j].c = c;
+}
+
+static void edge_del(EdgeSet *s, int axis, long pos, Client *c)
+{
+    int i = edge_of(s, axis, pos, c);
+
+    if (i < 0)
+        return;
+    s->n[axis]--;
+    memmove(&s->e[axis][i], &s->e[axis][i + 1],
+        (s->n[axis] - i) * sizeof(Edge));
+}
+
+/* Index of c's edge at pos, or -1. Others may be at the same pos, but
+ * never many. */
+
+static int edge_of(EdgeSet *s, int axis, long pos, Client *c)
+{
+    int i;
+
+    for (i = edge_find(s, axis, pos); i < s->n[axis] &&
+            s->e[axis][i].pos == pos; i++)
+        if (s->e[axis][i].c == c)
+            return i;
+    return -1;
+}
+
+/* Index of the first edge at or after pos. */
+
+static int edge_find(EdgeSet *s, int axis, long pos)
+{
+    int lo = 0, hi = s->n[axis], mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (s->e[axis][mid].pos < pos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* One of our edges is at "at" on this axis, and we run from lo to hi along
+ * the other one. Only edges that overlap that span are any use. */
+
+static void edge_nearest(EdgeSet *s, int axis, Client *c, long at,
+    long lo, long hi, long *best)
+{
+    Edge *e;
+    int i;
+
+    for (i = edge_find(s, axis, at - opt_sn); i < s->n[axis]; i++) {
+        e = &s->e[axis][i];
+        if (e->pos > at + opt_sn)
+            break;
+        if (e->c != c && e->c->mapped && e->lo <= hi && e->hi >= lo)
+            edge_try(e->pos, at, best);
+    }
+}
+
+static void edge_try(long to, long at, long *best)
+{
+    if (labs(to - at) < labs(*best)) *best = to - at;
+}
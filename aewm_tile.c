@@ -0,0 +1,236 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "aewm.h"
+
+/*
+ * A desk can be given a layout with "layout <desk> <name>" in the rc file
+ * (or --layout). Its framed, ordinary windows are then kept in tiles that
+ * fill the space inside its braces, oldest first, each monitor (see
+ * aewm_output.c) being tiled on its own with the windows that are on it:
+ *
+ *  - tile: the first window takes the left half, and the rest share the
+ *    right half, one above the other.
+ *  - grid: as many columns as rows (or one more), with the last row
+ *    stretched across if it comes up short.
+ *
+ * "float", the default, leaves everything alone.
+ *
+ * Showing, hiding, or losing a window only marks its desk; the tiles are
+ * worked out again the next time we're about to wait for events, so a
+ * program that maps several windows at once gets one relayout, not one
+ * per window. That only involves the geometry we already have, and the
+ * struts each window set when it turned up or last changed them (see
+ * desk_braces_sum), so a panel coming, going, or changing its strut is
+ * just another reason to mark the desks. Windows whose tile didn't change
+ * are left alone, and everything else goes out in one go, with no round
+ * trips in between.
+ */
+
+#define TILE_FLOAT 0
+#define TILE_TILE 1
+#define TILE_GRID 2
+
+typedef struct {
+    unsigned long desk;
+    int layout;
+    Bool dirty;
+} DeskLayout;
+
+static DeskLayout *desk_layout(unsigned long desk, Bool create);
+static void tile_flush(void);
+static void tile_arrange(unsigned long desk, int layout);
+static void tile_output(int layout, Client **tiled, unsigned int n,
+    unsigned long desk, int out);
+static void tile_slot(int layout, int i, int n, Brace b, Geom *s);
+static void tile_fit(Client *c, Geom s);
+static int tile_cmp(const void *a, const void *b);
+
+static DeskLayout *layouts;
+static int nlayouts;
+
+void tile_layout_set(unsigned long desk, char *name)
+{
+    DeskLayout *d = desk_layout(desk, True);
+
+    if (strcmp(name, "float") == 0) d->layout = TILE_FLOAT;
+    else if (strcmp(name, "tile") == 0) d->layout = TILE_TILE;
+    else if (strcmp(name, "grid") == 0) d->layout = TILE_GRID;
+    else fprintf(stderr, "aewm: unknown layout '%s'\n", name);
+}
+
+/* Whether we, rather than the client or the user, decide where c goes. */
+
+Bool tile_owns(Client *c)
+{
+    DeskLayout *d = desk_layout(c->desk, False);
+
+    return d && d->layout != TILE_FLOAT && c->frame && !c->trans &&
+        !c->zoomed && !c->fullscreen;
+}
+
+/* A window on every desk marks all of them, since its strut (if any)
+ * takes space from each. */
+
+void tile_dirty(unsigned long desk)
+{
+    int i;
+
+    for (i = 0; i < nlayouts; i++) {
+        if ((layouts[i].desk == desk || desk == DESK_ALL) &&
+                layouts[i].layout != TILE_FLOAT) {
+            layouts[i].dirty = True;
+            timer_set(tile_flush, 0);
+        }
+    }
+}
+
+void tile_free(void)
+{
+    free(layouts);
+    layouts = NULL;
+    nlayouts = 0;
+}
+
+static DeskLayout *desk_layout(unsigned long desk, Bool create)
+{
+    int i;
+
+    for (i = 0; i < nlayouts; i++)
+        if (layouts[i].desk == desk) return &layouts[i];
+    if (!create)
+        return NULL;
+
+    layouts = realloc(layouts, (nlayouts + 1) * sizeof *layouts);
+    layouts[nlayouts].desk = desk;
+    layouts[nlayouts].layout = TILE_FLOAT;
+    layouts[nlayouts].dirty = False;
+    return &layouts[nlayouts++];
+}
+
+/* A desk's layout goes for that desk on every screen. */
+
+static void tile_flush(void)
+{
+    int i, n;
+
+    for (i = 0; i < nlayouts; i++) {
+        if (layouts[i].dirty) {
+            layouts[i].dirty = False;
+            for (n = 0; n < nscreens; n++) {
+                scr = &screens[n];
+                tile_arrange(layouts[i].desk, layouts[i].layout);
+            }
+        }
+    }
+}
+
+static void tile_arrange(unsigned long desk, int layout)
+{
+    Client *c, **tiled;
+    unsigned int i, n = 0;
+    int out;
+
+    if (!(tiled = malloc(scr->nwins * sizeof *tiled)))
+        return;
+    for (i = 0; i < scr->nwins; i++)
+        if (FIND_TOP(scr->wins[i], &c) && c->desk == desk && c->mapped &&
+                tile_owns(c))
+            tiled[n++] = c;
+    qsort(tiled, n, sizeof *tiled, tile_cmp);
+
+    for (out = 0; out < scr->noutputs; out++)
+        tile_output(layout, tiled, n, desk, out);
+    free(tiled);
+}
+
+/* Tile the ones in tiled that are on output out. They stay on it, so
+ * nothing is tiled twice. */
+
+static void tile_output(int layout, Client **tiled, unsigned int n,
+    unsigned long desk, int out)
+{
+    Client *c;
+    Brace b;
+    Geom s, old;
+    unsigned int i, j, k = 0;
+
+    for (i = 0; i < n; i++)
+        if (output_of(tiled[i]) == out) k++;
+    if (!k)
+        return;
+
+    b = desk_braces_sum(desk, out);
+    for (i = j = 0; i < n; i++) {
+        c = tiled[i];
+        if (output_of(c) != out)
+            continue;
+        old = c->geom;
+        tile_slot(layout, j++, k, b, &s);
+        tile_fit(c, s);
+        if (c->geom.x != old.x || c->geom.y != old.y ||
+                c->geom.w != old.w || c->geom.h != old.h) {
+            cli_geom_apply(c, old);
+            stats.tiles_moved++;
+        }
+    }
+}
+
+/* The outer bounds of tile i of n. */
+
+static void tile_slot(int layout, int i, int n, Brace b, Geom *s)
+{
+    long w = b.r - b.l, h = b.b - b.t;
+    int cols, rows, row, col, across;
+
+    if (layout == TILE_TILE) {
+        if (i == 0) {
+            s->x = b.l;
+            s->y = b.t;
+            s->w = n == 1 ? w : w / 2;
+            s->h = h;
+        } else {
+            s->x = b.l + w / 2;
+            s->w = w - w / 2;
+            s->y = b.t + h * (i - 1) / (n - 1);
+            s->h = b.t + h * i / (n - 1) - s->y;
+        }
+    } else {
+        for (cols = 1; cols * cols < n; cols++)
+            ;
+        rows = (n + cols - 1) / cols;
+        row = i / cols;
+        col = i % cols;
+        across = row == rows - 1 ? n - cols * (rows - 1) : cols;
+        s->x = b.l + w * col / across;
+        s->w = b.l + w * (col + 1) / across - s->x;
+        s->y = b.t + h * row / rows;
+        s->h = b.t + h * (row + 1) / rows - s->y;
+    }
+}
+
+/* Size the client to fill the tile as far as its size hints allow, and
+ * keep the frame in the tile's top left corner. */
+
+static void tile_fit(Client *c, Geom s)
+{
+    Geom f;
+
+    c->geom.w = s.w - 2 * BW(c);
+    c->geom.h = s.h - GH(c) - 2 * BW(c);
+    cli_geom_fixup(c);
+    f = cli_frame_geom(c, c->geom);
+    c->geom.x += s.x - L(f, c);
+    c->geom.y += s.y - T(f, c);
+}
+
+static int tile_cmp(const void *a, const void *b)
+{
+    const Client *ca = *(Client * const *)a, *cb = *(Client * const *)b;
+
+    return ca->seq < cb->seq ? -1 : ca->seq > cb->seq;
+}
@@ -0,0 +1,699 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "aewm.h"
+
+#define ELLIPSIS "..."
+
+#ifdef XFT
+#define COVER_NONE -1
+
+typedef struct {
+    unsigned long ucs;   /* code point, or 0 for an empty slot */
+    int font;            /* index into fb_set, or COVER_NONE */
+} Cover;
+#endif
+
+static void title_fetch(Client *, long);
+static void title_flush(void);
+static void title_layout(Client *, long);
+#ifdef TITLE_GLYPHS
+static Bool glyph_get(unsigned long, TitleGlyph *, int *);
+static int utf8_get(const char *, int, unsigned long *);
+#else
+static int text_width(const char *, int);
+static int utf8_len(const char *, int);
+#ifdef X_HAVE_UTF8_STRING
+static XFontSet title_font_set(void);
+#endif
+#endif
+#ifdef XFT
+static XftDraw *title_surface(Client *);
+static void title_move(Title *, int, int);
+static XftFont *font_for(unsigned long);
+static Cover *cover_get(unsigned long);
+static void cover_grow(void);
+static int fb_search(unsigned long);
+static XftFont *fb_open(int);
+#else
+#ifdef RENDER
+static XCharStruct *char_get(unsigned long, unsigned int *);
+static void atlas_load(unsigned int *, int);
+static void atlas_add(Glyph *, XGlyphInfo *, int);
+static Picture title_pict(Client *);
+#endif
+#endif
+
+#ifdef XFT
+static FcPattern *fb_pat;
+static FcFontSet *fb_set;
+static Bool fb_tried;
+static XftFont **fb_fonts;
+static Cover *cover;
+static unsigned int cover_size, cover_used;
+#else
+#ifdef RENDER
+static GlyphSet atlas;
+static XRenderPictFormat *atlas_fmt;
+static unsigned char atlas_has[0x10000 / 8];
+static GC atlas_gc;
+#endif
+#endif
+
+/*
+ * Titles are drawn from a cached layout: the longest prefix of the name
+ * that fits in the titlebar, with an ellipsis tacked on if we had to cut
+ * anything. Measuring is the expensive part (Xft has to look up and
+ * possibly rasterize every glyph), so we only redo it when the name, the
+ * font, or the space between the padding and the box changes. Everything
+ * past the cut is never sent to the server at all.
+ *
+ * With Xft, or with core fonts and RENDER, the layout is a run of glyph
+ * indices rather than bytes, and drawing it is one CompositeGlyphs
+ * request against glyphs the server already has. Otherwise it's the
+ * bytes, and the server looks the characters up again every time.
+ */
+
+void title_draw(Client *c, int x, int y, long avail)
+{
+    Title *t = &c->title;
+
+    if (t->name != c->name || t->avail != avail || t->font != TITLE_FONT)
+        title_layout(c, avail);
+
+    if (!t->len) return;
+    stats.title_draws++;
+
+#ifdef XFT
+    if (t->x != x || t->y != y)
+        title_move(t, x, y);
+    XftDrawGlyphFontSpec(title_surface(c), &c->vis->xft_fg, t->glyphs,
+        t->len);
+#else
+#ifdef RENDER
+    XRenderCompositeString32(dpy, PictOpOver, c->vis->fg_pict,
+        title_pict(c), atlas_fmt, atlas, 0, 0, x, y, t->glyphs, t->len);
+#else
+#ifdef X_HAVE_UTF8_STRING
+    Xutf8DrawString(dpy, c->frame, title_font_set(), c->vis->text_gc, x, y,
+        t->buf ? t->buf : c->name, t->len);
+#else
+    XDrawString(dpy, c->frame, c->vis->text_gc, x, y,
+        t->buf ? t->buf : c->name, t->len);
+#endif
+#endif
+#endif
+}
+
+/*
+ * Some clients retitle themselves constantly (shells on every prompt, build
+ * tools on every step), and each change costs us a round trip for the name
+ * and a redraw. So we go no faster than opt_tr per second per client. If a
+ * change comes in sooner than that, we just note it and let a timer pick up
+ * whatever the name is by then; any further changes in the meantime are
+ * dropped on the floor, which is the point. The first change after a quiet
+ * spell is still fetched and drawn right away.
+ */
+
+void title_update(Client *c)
+{
+    long now = time_msec(), gap = opt_tr > 0 ? 1000 / opt_tr : 0;
+
+    if (now - c->title_at >= gap) {
+        title_fetch(c, now);
+    } else {
+        if (c->title_due) {
+            c->title_dropped++;
+            stats.title_dropped++;
+        }
+        c->title_due = True;
+        timer_set(title_flush, c->title_at + gap - now);
+    }
+}
+
+static void title_fetch(Client *c, long now)
+{
+    title_clear(c);
+    if (c->name) XFree(c->name);
+    c->name = win_name_get(c->win);
+    c->title_due = False;
+    c->title_at = now;
+    cli_frame_redraw(c);
+}
+
+static void title_flush(void)
+{
+    long now = time_msec(), gap = opt_tr > 0 ? 1000 / opt_tr : 0, next = -1;
+    unsigned int i;
+    int n;
+    Client *c;
+
+    for (n = 0; n < nscreens; n++) {
+        scr = &screens[n];
+        for (i = 0; i < scr->nwins; i++) {
+            if (FIND_TOP(scr->wins[i], &c) && c->title_due) {
+                if (now - c->title_at >= gap)
+                    title_fetch(c, now);
+                else if (next < 0 || c->title_at + gap - now < next)
+                    next = c->title_at + gap - now;
+            }
+        }
+    }
+    if (next >= 0)
+        timer_set(title_flush, next);
+}
+
+/*
+ * Each frame gets its own Xft surface the first time its title is drawn.
+ * With opt_sd there is instead a single surface for each visual, pointed
+ * at whichever frame of that visual we're drawing on. That trades a
+ * client-side XftDraw and a server-side Picture per frame for having to
+ * make a new Picture whenever we draw on a different frame than last time.
+ *
+ * Either way, the surface must let go of the frame before it is destroyed.
+ */
+
+#ifdef XFT
+static XftDraw *title_surface(Client *c)
+{
+    Vis *v = c->vis;
+
+    if (opt_sd) {
+        if (!v->shared_draw)
+            v->shared_draw = XftDrawCreate(dpy, c->frame, v->visual, v->cmap);
+        else if (XftDrawDrawable(v->shared_draw) != c->frame)
+            XftDrawChange(v->shared_draw, c->frame);
+        return v->shared_draw;
+    }
+    if (!c->xftdraw)
+        c->xftdraw = XftDrawCreate(dpy, c->frame, v->visual, v->cmap);
+    return c->xftdraw;
+}
+#endif
+
+void title_surface_free(Client *c)
+{
+#ifdef XFT
+    if (c->xftdraw) {
+        XftDrawDestroy(c->xftdraw);
+        c->xftdraw = NULL;
+    }
+    if (c->vis->shared_draw &&
+            XftDrawDrawable(c->vis->shared_draw) == c->frame)
+        XftDrawChange(c->vis->shared_draw, c->scr->root);
+#else
+#ifdef RENDER
+    if (c->title_pict) {
+        XRenderFreePicture(dpy, c->title_pict);
+        c->title_pict = None;
+    }
+#endif
+#endif
+}
+
+/* Must be called whenever c->name is freed, since the allocator is free to
+ * hand the same address back to us for the next name. */
+
+void title_clear(Client *c)
+{
+    Title *t = &c->title;
+
+#ifdef TITLE_GLYPHS
+    if (t->glyphs) free(t->glyphs);
+    t->glyphs = NULL;
+#else
+    if (t->buf) free(t->buf);
+    t->buf = NULL;
+#endif
+    t->name = NULL;
+    t->font = NULL;
+    t->avail = 0;
+    t->len = 0;
+#ifdef XFT
+    t->x = t->y = 0;
+#endif
+}
+
+/* Like the Xft surface, the picture has to go before the frame does. */
+
+#ifndef XFT
+#ifdef RENDER
+static Picture title_pict(Client *c)
+{
+    if (!c->title_pict)
+        c->title_pict = XRenderCreatePicture(dpy, c->frame,
+            XRenderFindVisualFormat(dpy, c->vis->visual), 0, NULL);
+    return c->title_pict;
+}
+#endif
+#endif
+
+/* Glyph advances add up (neither Xft nor core fonts kern), so one pass
+ * measuring a character at a time tells us both whether the whole thing
+ * fits and, if not, the last character boundary that leaves room for the
+ * ellipsis. */
+
+#ifdef TITLE_GLYPHS
+static void title_layout(Client *c, long avail)
+{
+    Title *t = &c->title;
+    int len = strlen(c->name), i, n, adv, ng = 0, cut = 0, dot_w = 0;
+    TitleGlyph dot;
+    unsigned long ucs;
+    long w = 0, room;
+#ifdef XFT
+    long cut_w = 0;
+#endif
+
+    title_clear(c);
+    t->name = c->name;
+    t->avail = avail;
+    t->font = TITLE_FONT;
+
+    if (!glyph_get('.', &dot, &dot_w)) dot_w = 0;
+    room = avail - (long)(sizeof ELLIPSIS - 1) * dot_w;
+    if (!(t->glyphs = malloc((len + sizeof ELLIPSIS) * sizeof *t->glyphs)))
+        return;
+
+    for (i = 0; i < len; i += n) {
+        n = utf8_get(c->name + i, len - i, &ucs);
+        if (!glyph_get(ucs, &t->glyphs[ng], &adv)) continue;
+#ifdef XFT
+        t->glyphs[ng].x = w;
+        t->glyphs[ng].y = 0;
+#endif
+        w += adv;
+        ng++;
+        if (w <= room) {
+            cut = ng;
+#ifdef XFT
+            cut_w = w;
+#endif
+        }
+        if (w > avail) break;
+    }
+
+    if (i >= len && w <= avail) {
+        t->len = ng;
+    } else if (room > 0 && dot_w) {
+        for (t->len = cut; t->len < cut + (int)sizeof ELLIPSIS - 1; t->len++) {
+            t->glyphs[t->len] = dot;
+#ifdef XFT
+            t->glyphs[t->len].x = cut_w;
+            t->glyphs[t->len].y = 0;
+            cut_w += dot_w;
+#endif
+        }
+    }
+#ifndef XFT
+    atlas_load(t->glyphs, t->len);
+#endif
+}
+
+/* Xft keeps every glyph it has rendered in a GlyphSet of its own, keyed by
+ * glyph index, so all we have to remember is the index and which font's
+ * set it's in. */
+
+#ifdef XFT
+static Bool glyph_get(unsigned long ucs, TitleGlyph *g, int *adv)
+{
+    XGlyphInfo ext;
+
+    g->font = font_for(ucs);
+    g->glyph = XftCharIndex(dpy, g->font, ucs);
+    XftGlyphExtents(dpy, g->font, &g->glyph, 1, &ext);
+    *adv = ext.xOff;
+    return True;
+}
+
+/* Positions are laid out relative to wherever we drew last, which is
+ * nearly always the same place, so this is rarely needed. */
+
+static void title_move(Title *t, int x, int y)
+{
+    int i;
+
+    for (i = 0; i < t->len; i++) {
+        t->glyphs[i].x += x - t->x;
+        t->glyphs[i].y += y - t->y;
+    }
+    t->x = x;
+    t->y = y;
+}
+
+/*
+ * Characters xftfont doesn't have come from the first font in
+ * fontconfig's fallback list for it that does. Asking fontconfig to match
+ * each time would mean sorting every installed font, so we sort once, the
+ * first time we need to, and remember which font covered each code point
+ * we've looked up (including those that nothing covers) in a hash table
+ * shared by all clients. The fonts themselves are opened when first used.
+ *
+ * This only runs when a title is laid out; redraws reuse the glyphs.
+ */
+
+static XftFont *font_for(unsigned long ucs)
+{
+    Cover *e;
+
+    if (XftCharExists(dpy, xftfont, ucs))
+        return xftfont;
+    if (!(e = cover_get(ucs)) || e->font == COVER_NONE)
+        return xftfont;
+    return fb_open(e->font);
+}
+
+static Cover *cover_get(unsigned long ucs)
+{
+    unsigned int i;
+
+    if (2 * (cover_used + 1) > cover_size)
+        cover_grow();
+    if (!cover)
+        return NULL;
+
+    i = (ucs * 2654435761UL) & (cover_size - 1);
+    while (cover[i].ucs && cover[i].ucs != ucs)
+        i = (i + 1) & (cover_size - 1);
+    if (!cover[i].ucs) {
+        cover[i].ucs = ucs;
+        cover[i].font = fb_search(ucs);
+        cover_used++;
+    }
+    return &cover[i];
+}
+
+/* If we can't get a bigger table we carry on with the old one, which
+ * still has room, just more collisions. */
+
+static void cover_grow(void)
+{
+    Cover *old = cover, *e;
+    unsigned int old_size = cover_size, j;
+
+    cover_size = cover_size ? cover_size * 2 : 256;
+    if (!(cover = calloc(cover_size, sizeof *cover))) {
+        cover = old;
+        cover_size = old_size;
+        return;
+    }
+    for (e = old; e < old + old_size; e++) {
+        if (!e->ucs) continue;
+        j = (e->ucs * 2654435761UL) & (cover_size - 1);
+        while (cover[j].ucs)
+            j = (j + 1) & (cover_size - 1);
+        cover[j] = *e;
+    }
+    if (old) free(old);
+}
+
+static int fb_search(unsigned long ucs)
+{
+    FcCharSet *cs;
+    FcResult res;
+    int i;
+
+    if (!fb_tried) {
+        fb_tried = True;
+        if ((fb_pat = FcNameParse((FcChar8 *)opt_xftfont))) {
+            FcConfigSubstitute(NULL, fb_pat, FcMatchPattern);
+            XftDefaultSubstitute(dpy, scr->num, fb_pat);
+            if ((fb_set = FcFontSort(NULL, fb_pat, FcTrue, NULL, &res)) &&
+                    !(fb_fonts = calloc(fb_set->nfont, sizeof *fb_fonts))) {
+                FcFontSetDestroy(fb_set);
+                fb_set = NULL;
+            }
+        }
+    }
+
+    for (i = 0; fb_set && i < fb_set->nfont; i++)
+        if (FcPatternGetCharSet(fb_set->fonts[i], FC_CHARSET, 0, &cs) ==
+                FcResultMatch && FcCharSetHasChar(cs, ucs))
+            return i;
+    return COVER_NONE;
+}
+
+static XftFont *fb_open(int i)
+{
+    FcPattern *p;
+
+    if (!fb_fonts[i] &&
+            (p = FcFontRenderPrepare(NULL, fb_pat, fb_set->fonts[i])) &&
+            !(fb_fonts[i] = XftFontOpenPattern(dpy, p)))
+        FcPatternDestroy(p);
+    return fb_fonts[i] ? fb_fonts[i] : xftfont;
+}
+
+void title_fonts_free(void)
+{
+    int i;
+
+    if (fb_set) {
+        for (i = 0; i < fb_set->nfont; i++)
+            if (fb_fonts[i]) XftFontClose(dpy, fb_fonts[i]);
+        free(fb_fonts);
+        FcFontSetDestroy(fb_set);
+    }
+    if (fb_pat) FcPatternDestroy(fb_pat);
+    if (cover) free(cover);
+}
+#else
+static Bool glyph_get(unsigned long ucs, unsigned int *id, int *adv)
+{
+    XCharStruct *cs = char_get(ucs, id);
+
+    if (!cs) return False;
+    *adv = cs->width;
+    return True;
+}
+
+/* Core fonts are indexed by the two bytes of the character, which for an
+ * ISO10646-1 font are the high and low bytes of the code point, and for
+ * a single-byte (ISO8859-1) one just the low byte, the high one being 0.
+ * Characters the font doesn't have become its default_char, or nothing.
+ * The glyph id we use for the atlas is the code point we ended up with. */
+
+static XCharStruct *char_get(unsigned long ucs, unsigned int *id)
+{
+    unsigned int b1 = ucs >> 8, b2 = ucs & 0xff, cols;
+    XCharStruct *cs = NULL;
+
+    if (ucs <= 0xffff && b1 >= font->min_byte1 && b1 <= font->max_byte1 &&
+            b2 >= font->min_char_or_byte2 && b2 <= font->max_char_or_byte2) {
+        if (font->per_char) {
+            cols = font->max_char_or_byte2 - font->min_char_or_byte2 + 1;
+            cs = &font->per_char[(b1 - font->min_byte1) * cols +
+                b2 - font->min_char_or_byte2];
+            if (!cs->width && !cs->ascent && !cs->descent &&
+                    !cs->lbearing && !cs->rbearing)
+                cs = NULL;
+        } else {
+            cs = &font->max_bounds;
+        }
+    }
+
+    if (cs)
+        *id = ucs;
+    else if (ucs != font->default_char)
+        cs = char_get(font->default_char, id);
+    return cs;
+}
+
+/*
+ * The atlas is a GlyphSet holding every character of the core font that
+ * has appeared in a title so far. New ones are drawn side by side into a
+ * scratch bitmap and read back with one GetImage, then uploaded with one
+ * AddGlyphs, so a title full of characters we haven't seen costs a single
+ * round trip, and one we have costs nothing. Nothing is ever evicted; a
+ * core font has at most 64K glyphs, and titles use few of them.
+ */
+
+static void atlas_load(unsigned int *glyphs, int n)
+{
+    Glyph *ids = malloc(n * sizeof *ids);
+    XGlyphInfo *info = malloc(n * sizeof *info), *g;
+    XCharStruct *cs;
+    unsigned int id;
+    int i, nnew = 0;
+
+    if (!atlas) {
+        atlas_fmt = XRenderFindStandardFormat(dpy, PictStandardA8);
+        atlas = XRenderCreateGlyphSet(dpy, atlas_fmt);
+    }
+
+    for (i = 0; ids && info && i < n; i++) {
+        id = glyphs[i];
+        if (atlas_has[id >> 3] & (1 << (id & 7))) continue;
+        atlas_has[id >> 3] |= 1 << (id & 7);
+        cs = char_get(id, &id);
+        g = &info[nnew];
+        g->width = cs->rbearing - cs->lbearing;
+        g->height = cs->ascent + cs->descent;
+        if (cs->rbearing <= cs->lbearing || cs->ascent + cs->descent <= 0)
+            g->width = g->height = 0;
+        g->x = -cs->lbearing;
+        g->y = cs->ascent;
+        g->xOff = cs->width;
+        g->yOff = 0;
+        ids[nnew++] = id;
+    }
+    if (nnew)
+        atlas_add(ids, info, nnew);
+
+    if (ids) free(ids);
+    if (info) free(info);
+}
+
+static void atlas_add(Glyph *ids, XGlyphInfo *info, int n)
+{
+    XImage *img = NULL;
+    Pixmap pm;
+    XChar2b ch;
+    char *data, *p;
+    int i, j, k, x, y, w = 0, size = 0, asc = font->max_bounds.ascent,
+        h = asc + font->max_bounds.descent;
+
+    for (i = 0; i < n; i++) {
+        w += info[i].width;
+        size += ((info[i].width + 3) & ~3) * info[i].height;
+    }
+    if (!(p = data = malloc(size ? size : 1))) return;
+
+    if (w > 0 && h > 0) {
+        pm = XCreatePixmap(dpy, DefaultRootWindow(dpy), w, h, 1);
+        if (!atlas_gc) {
+            atlas_gc = XCreateGC(dpy, pm, 0, NULL);
+            XSetFont(dpy, atlas_gc, font->fid);
+        }
+        XSetForeground(dpy, atlas_gc, 0);
+        XFillRectangle(dpy, pm, atlas_gc, 0, 0, w, h);
+        XSetForeground(dpy, atlas_gc, 1);
+        for (i = 0, x = 0; i < n; x += info[i++].width) {
+            ch.byte1 = ids[i] >> 8;
+            ch.byte2 = ids[i] & 0xff;
+            XDrawString16(dpy, pm, atlas_gc, x + info[i].x, asc, &ch, 1);
+        }
+        img = XGetImage(dpy, pm, 0, 0, w, h, 1, ZPixmap);
+        XFreePixmap(dpy, pm);
+    }
+
+    for (i = 0, x = 0; i < n; x += info[i++].width) {
+        for (j = 0; j < info[i].height; j++) {
+            y = asc - info[i].y + j;
+            for (k = 0; k < ((info[i].width + 3) & ~3); k++)
+                *p++ = img && k < info[i].width && y >= 0 && y < h &&
+                    XGetPixel(img, x + k, y) ? 0xff : 0;
+        }
+    }
+    XRenderAddGlyphs(dpy, atlas, ids, info, n, data, p - data);
+
+    if (img) XDestroyImage(img);
+    free(data);
+}
+#endif
+
+/* Without UTF-8 support every byte is a character, and a Latin-1 one at
+ * that, so it is its own code point. */
+
+static int utf8_get(const char *s, int left, unsigned long *ucs)
+{
+    unsigned char *u = (unsigned char *)s;
+    int n = 1;
+#ifdef X_HAVE_UTF8_STRING
+    int extra = 0;
+#endif
+
+    *ucs = u[0];
+#ifdef X_HAVE_UTF8_STRING
+    if (u[0] >= 0xf0) { *ucs = u[0] & 0x07; extra = 3; }
+    else if (u[0] >= 0xe0) { *ucs = u[0] & 0x0f; extra = 2; }
+    else if (u[0] >= 0xc0) { *ucs = u[0] & 0x1f; extra = 1; }
+    for (; n <= extra && n < left && (u[n] & 0xc0) == 0x80; n++)
+        *ucs = (*ucs << 6) | (u[n] & 0x3f);
+    if (n <= extra) *ucs = 0xfffd;
+#endif
+    return n;
+}
+#else
+static void title_layout(Client *c, long avail)
+{
+    Title *t = &c->title;
+    int len = strlen(c->name), i, n, cut = 0;
+    long w = 0, room = avail - text_width(ELLIPSIS, strlen(ELLIPSIS));
+
+    title_clear(c);
+    t->name = c->name;
+    t->avail = avail;
+    t->font = TITLE_FONT;
+
+    for (i = 0; i < len; i += n) {
+        n = utf8_len(c->name + i, len - i);
+        w += text_width(c->name + i, n);
+        if (w <= room) cut = i + n;
+        if (w > avail) break;
+    }
+
+    if (i >= len && w <= avail) {
+        t->len = len;
+    } else if (room > 0 && (t->buf = malloc(cut + sizeof ELLIPSIS))) {
+        memcpy(t->buf, c->name, cut);
+        memcpy(t->buf + cut, ELLIPSIS, sizeof ELLIPSIS);
+        t->len = cut + strlen(ELLIPSIS);
+    }
+}
+
+static int text_width(const char *s, int len)
+{
+#ifdef XFT
+    XGlyphInfo ext;
+
+#ifdef X_HAVE_UTF8_STRING
+    XftTextExtentsUtf8(dpy, xftfont, (unsigned char *)s, len, &ext);
+#else
+    XftTextExtents8(dpy, xftfont, (unsigned char *)s, len, &ext);
+#endif
+    return ext.xOff;
+#else
+#ifdef X_HAVE_UTF8_STRING
+    return Xutf8TextEscapement(title_font_set(), (char *)s, len);
+#else
+    return XTextWidth(font, s, len);
+#endif
+#endif
+}
+
+/* Without UTF-8 support every byte is a character. With it, we step over
+ * continuation bytes, so a multibyte character is never split. */
+
+static int utf8_len(const char *s, int left)
+{
+    int n = 1;
+
+#ifdef X_HAVE_UTF8_STRING
+    while (n < left && (s[n] & 0xc0) == 0x80) n++;
+#endif
+    return n;
+}
+
+/* Creating a font set means loading a font for every charset the locale
+ * might need, which with a big locale takes a while. We put that off until
+ * there's a title to draw, so it doesn't hold up startup. */
+
+#ifdef X_HAVE_UTF8_STRING
+static XFontSet title_font_set(void)
+{
+    char **missing, *def_str;
+    int nmissing;
+
+    if (!font_set) {
+        font_set = XCreateFontSet(dpy, opt_font, &missing, &nmissing,
+            &def_str);
+        if (nmissing) XFreeStringList(missing);
+    }
+    return font_set;
+}
+#endif
+#endif
@@ -0,0 +1,430 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#include <stdlib.h>
+#include <X11/Xatom.h>
+#include "aewm.h"
+
+/*
+ * With --desksize bigger than the screen, each desk is that big, and the
+ * screen shows the part of it at the desk's viewport. Rather than move
+ * every frame when we pan, the frames on a desk live in a box: a plain
+ * window the size of the whole desk, which is all we move. So panning is
+ * one request, however many windows there are.
+ *
+ * c->geom is then in the coordinates of c's desk, and VX(c), VY(c) is
+ * where the viewport is on it; the client is on the screen at geom - V.
+ * Sticky clients stay on the root and don't pan, so for them V is always
+ * 0. Clients we don't frame, or haven't yet, are on the root as well, and
+ * have to be moved along with the box by hand.
+ *
+ * So that panning doesn't have to look at every window for those, each
+ * view keeps a list of its desk's clients that are loose on the root, and
+ * there's one more for the sticky ones (under DESK_ALL, with no box).
+ *
+ * The boxes are at the bottom of the root's stack, and everything else on
+ * the root stays over the current one: a client lowered from there only
+ * goes as far as just over it. The exception is the desktop, which is
+ * kept under it, as it would otherwise cover every frame on the desk.
+ *
+ * Moving the box moves the clients in it on the screen, which ICCCM says
+ * we have to tell them about with a synthetic ConfigureNotify. Most of
+ * them don't care, and on a big desk most of them are out of sight, so we
+ * don't do that while the viewport is moving. Once it has been still for
+ * VIEW_SETTLE msec, the ones that are now on screen (the grid knows which
+ * ones those are) get told, and anyone else is told when it gets focus.
+ */
+
+#define VIEW_SETTLE 100
+
+typedef struct View {
+    unsigned long desk;
+    Window box;          /* holds the frames on desk, or None */
+    long x, y;           /* top left of the screen on the desk */
+    Client **loose;      /* clients on desk that are on the root */
+    int nloose;
+} View;
+
+static View *view_get(unsigned long desk, Bool create);
+static void view_move(View *v, long x, long y);
+static void view_sink(View *v);
+/* Put v's box at the bottom of the stack, with only the desktop under it,
+ * whether that's on v's desk or sticky. */
+
+static void view_sink(View *v)
+{
+    View *s = view_get(DESK_ALL, False);
+    int i;
+
+    XLowerWindow(dpy, v->box);
+    for (i = 0; i < v->nloose; i++)
+        if (v->loose[i]->desktop) XLowerWindow(dpy, TOP(v->loose[i]));
+    for (i = 0; s && i < s->nloose; i++)
+        if (s->loose[i]->desktop) XLowerWindow(dpy, TOP(s->loose[i]));
+}
+
+static void view_size(void);
+static void view_publish(void);
+static void view_flush(void);
+static void view_flush_one(Client *c);
+
+
+/* Called before we look at any clients, so that we can pick up where a
+ * previous window manager's viewports were. Its boxes are gone, so the
+ * clients are on the root, wherever they were on the screen. */
+
+void view_init(void)
+{
+    unsigned long d, n, *vp;
+    View *v;
+
+    view_size();
+    if (VIEWING && (vp = malloc(2 * scr->ndesks * sizeof *vp))) {
+        n = atom_get(scr->root, net_desk_viewport, XA_CARDINAL, 0, vp,
+            2 * scr->ndesks, NULL) / 2;
+        for (d = 0; d < n; d++) {
+            v = view_get(d, True);
+            v->x = vp[2 * d];
+            v->y = vp[2 * d + 1];
+        }
+        free(vp);
+    }
+    view_publish();
+}
+
+long view_x(unsigned long desk)
+{
+    View *v;
+
+    return VIEWING && desk != DESK_ALL && (v = view_get(desk, False)) ?
+        v->x : 0;
+}
+
+long view_y(unsigned long desk)
+{
+    View *v;
+
+    return VIEWING && desk != DESK_ALL && (v = view_get(desk, False)) ?
+        v->y : 0;
+}
+
+/* What a client's frame should be a child of. Only the current desk's box
+ * is mapped. */
+
+Window view_parent(Client *c)
+{
+    XSetWindowAttributes attr;
+    View *v;
+
+    if (!VIEWING || c->desk == DESK_ALL)
+        return scr->root;
+
+    v = view_get(c->desk, True);
+    if (!v->box) {
+        attr.override_redirect = True;
+        attr.background_pixmap = ParentRelative;
+        v->box = XCreateWindow(dpy, scr->root, -v->x, -v->y,
+            scr->desk_w, scr->desk_h, 0, CopyFromParent, InputOutput,
+            CopyFromParent, CWOverrideRedirect|CWBackPixmap, &attr);
+        view_sink(v);
+        if (v->desk == scr->cur_desk)
+            XMapWindow(dpy, v->box);
+        scr->wins_stale = True;
+    }
+    return v->box;
+}
+
+/* The box that c stacks against, if it's on the root: that of its desk,
+ * or for a sticky client, of the current one. None if c is in a box, or
+ * there isn't one to go by. */
+
+Window view_floor(Client *c)
+{
+    View *v;
+
+    if (!VIEWING || (c->frame && c->desk != DESK_ALL))
+        return None;
+    v = view_get(c->desk == DESK_ALL ? scr->cur_desk : c->desk, False);
+    return v ? v->box : None;
+}
+
+/* Put c on the list it belongs on now, if any. Called whenever it gains
+ * or loses its frame, or changes desks. */
+
+void view_track(Client *c)
+{
+    View *v;
+
+    if (c->loose && ((c->frame && c->desk != DESK_ALL) ||
+            c->loose_desk != c->desk))
+        view_untrack(c);
+    if (!c->loose && (!c->frame || c->desk == DESK_ALL)) {
+        v = view_get(c->desk, True);
+        v->loose = realloc(v->loose, (v->nloose + 1) * sizeof *v->loose);
+        v->loose[v->nloose++] = c;
+        c->loose = True;
+        c->loose_desk = c->desk;
+    }
+}
+
+void view_untrack(Client *c)
+{
+    View *v;
+    int i;
+
+    if (!c->loose || !(v = view_get(c->loose_desk, False)))
+        return;
+    for (i = 0; i < v->nloose; i++)
+        if (v->loose[i] == c) {
+            v->loose[i] = v->loose[--v->nloose];
+            break;
+        }
+    c->loose = False;
+}
+
+Bool view_is_box(Window w)
+{
+    int i;
+
+    for (i = 0; i < scr->nviews; i++)
+        if (scr->views[i].box == w) return True;
+    return False;
+}
+
+/* How far c's coordinates are from those of the current desk, which is
+ * what the snap index and the grid go by. Only sticky clients are ever
+ * anywhere but 0 from it: they're on the screen, wherever that is. */
+
+void view_offset(Client *c, long *x, long *y)
+{
+    *x = c->desk == DESK_ALL ? view_x(scr->cur_desk) : 0;
+    *y = c->desk == DESK_ALL ? view_y(scr->cur_desk) : 0;
+}
+
+Geom view_frame_geom(Client *c)
+{
+    Geom f = cli_frame_geom(c, c->geom);
+    long x, y;
+
+    view_offset(c, &x, &y);
+    f.x += x;
+    f.y += y;
+    return f;
+}
+
+/* Move c to another desk, keeping it at the same place on the screen. */
+
+void view_desk_set(Client *c, unsigned long desk)
+{
+    long x = VX(c), y = VY(c);
+    Geom f;
+
+    c->desk = desk;
+    c->geom.x += VX(c) - x;
+    c->geom.y += VY(c) - y;
+    if (c->frame && VIEWING) {
+        f = cli_frame_geom(c, c->geom);
+        XReparentWindow(dpy, c->frame, view_parent(c), f.x, f.y);
+        scr->wins_stale = True;
+    }
+    view_track(c);
+}
+
+/* Scroll desk so that the top left of the screen is at (x, y) on it. */
+
+void view_pan(unsigned long desk, long x, long y)
+{
+    View *v;
+
+    if (!VIEWING || desk == DESK_ALL)
+        return;
+    if (x > scr->desk_w - scr->rw) x = scr->desk_w - scr->rw;
+    if (y > scr->desk_h - scr->rh) y = scr->desk_h - scr->rh;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    v = view_get(desk, True);
+    if (x != v->x || y != v->y)
+        view_move(v, x, y);
+}
+
+/* The screen changed size. The desks are never smaller than it, and the
+ * viewports have to stay on them. */
+
+void view_resize(void)
+{
+    View *v;
+    long x, y;
+    int i;
+
+    view_size();
+    for (i = 0; i < scr->nviews; i++) {
+        v = &scr->views[i];
+        x = v->x < scr->desk_w - scr->rw ? v->x : scr->desk_w - scr->rw;
+        y = v->y < scr->desk_h - scr->rh ? v->y : scr->desk_h - scr->rh;
+        if (v->box)
+            XResizeWindow(dpy, v->box, scr->desk_w, scr->desk_h);
+        if (x != v->x || y != v->y)
+            view_move(v, x, y);
+    }
+}
+
+/* Pan c's desk just far enough to bring c's frame into view, or center
+ * it if it doesn't fit. */
+
+void view_show(Client *c)
+{
+    Geom f = cli_frame_geom(c, c->geom);
+    long x = VX(c), y = VY(c);
+
+    if (!VIEWING || c->desk == DESK_ALL)
+        return;
+    if (R(f, c) - L(f, c) > scr->rw) x = (L(f, c) + R(f, c) - scr->rw) / 2;
+    else if (L(f, c) < x) x = L(f, c);
+    else if (R(f, c) > x + scr->rw) x = R(f, c) - scr->rw;
+    if (B(f, c) - T(f, c) > scr->rh) y = (T(f, c) + B(f, c) - scr->rh) / 2;
+    else if (T(f, c) < y) y = T(f, c);
+    else if (B(f, c) > y + scr->rh) y = B(f, c) - scr->rh;
+    view_pan(c->desk, x, y);
+}
+
+/* Only the current desk's box is shown, under everything else on the root
+ * but the desktop, and the sticky clients are now somewhere else on the
+ * current desk. */
+
+void view_desk_switch(unsigned long from)
+{
+    View *v;
+    int i;
+
+    if (!VIEWING)
+        return;
+    if ((v = view_get(from, False)) && v->box)
+        XUnmapWindow(dpy, v->box);
+    if ((v = view_get(scr->cur_desk, False)) && v->box) {
+        view_sink(v);
+        XMapWindow(dpy, v->box);
+    }
+
+    if ((v = view_get(DESK_ALL, False)))
+        for (i = 0; i < v->nloose; i++)
+            if (v->loose[i]->mapped) cli_index(v->loose[i]);
+    timer_set(view_flush, 0);
+}
+
+/* Send c the ConfigureNotify it's owed from panning, if any. */
+
+void view_notify(Client *c)
+{
+    if (c->frame && (c->sent_x != c->geom.x - VX(c) ||
+            c->sent_y != c->geom.y - VY(c))) {
+        cli_send_cfg(c);
+        stats.view_notified++;
+    }
+}
+
+void view_free(void)
+{
+    int i;
+
+    for (i = 0; i < scr->nviews; i++) {
+        if (scr->views[i].box) XDestroyWindow(dpy, scr->views[i].box);
+        free(scr->views[i].loose);
+    }
+    free(scr->views);
+    scr->views = NULL;
+    scr->nviews = 0;
+    XDeleteProperty(dpy, scr->root, net_desk_geom);
+    XDeleteProperty(dpy, scr->root, net_desk_viewport);
+}
+
+static View *view_get(unsigned long desk, Bool create)
+{
+    int i;
+
+    for (i = 0; i < scr->nviews; i++)
+        if (scr->views[i].desk == desk) return &scr->views[i];
+    if (!create)
+        return NULL;
+
+    scr->views = realloc(scr->views, (scr->nviews + 1) * sizeof *scr->views);
+    scr->views[scr->nviews].desk = desk;
+    scr->views[scr->nviews].box = None;
+    scr->views[scr->nviews].x = 0;
+    scr->views[scr->nviews].y = 0;
+    scr->views[scr->nviews].loose = NULL;
+    scr->views[scr->nviews].nloose = 0;
+    return &scr->views[scr->nviews++];
+}
+
+static void view_move(View *v, long x, long y)
+{
+    View *s;
+    Client *c;
+    int i;
+
+    v->x = x;
+    v->y = y;
+    if (v->box)
+        XMoveWindow(dpy, v->box, -x, -y);
+
+    /* That's it for the frames. Anything of ours outside the box is only
+     * looked at, apart from the odd unframed window. */
+    for (i = 0; i < v->nloose; i++) {
+        c = v->loose[i];
+        if (c->mapped)
+            XMoveWindow(dpy, c->win, c->geom.x - x, c->geom.y - y);
+    }
+    if (v->desk == scr->cur_desk && (s = view_get(DESK_ALL, False)))
+        for (i = 0; i < s->nloose; i++)
+            if (s->loose[i]->mapped) cli_index(s->loose[i]);
+
+    view_publish();
+    stats.view_pans++;
+    timer_clear(view_flush);
+    timer_set(view_flush, VIEW_SETTLE);
+}
+
+static void view_size(void)
+{
+    unsigned long size[2];
+
+    scr->desk_w = opt_dw > scr->rw ? opt_dw : scr->rw;
+    scr->desk_h = opt_dh > scr->rh ? opt_dh : scr->rh;
+    size[0] = scr->desk_w;
+    size[1] = scr->desk_h;
+    atom_set(scr->root, net_desk_geom, XA_CARDINAL, size, 2);
+}
+
+static void view_publish(void)
+{
+    unsigned long d, *vp;
+
+    if (!(vp = malloc(2 * scr->ndesks * sizeof *vp)))
+        return;
+    for (d = 0; d < scr->ndesks; d++) {
+        vp[2 * d] = view_x(d);
+        vp[2 * d + 1] = view_y(d);
+    }
+    atom_set(scr->root, net_desk_viewport, XA_CARDINAL, vp, 2 * scr->ndesks);
+    free(vp);
+}
+
+static void view_flush(void)
+{
+    long x, y;
+    int i;
+
+    for (i = 0; i < nscreens; i++) {
+        scr = &screens[i];
+        x = view_x(scr->cur_desk);
+        y = view_y(scr->cur_desk);
+        grid_each(x, y, x + scr->rw, y + scr->rh, view_flush_one);
+    }
+}
+
+static void view_flush_one(Client *c)
+{
+    if (c->mapped && c->desk == scr->cur_desk)
+        view_notify(c);
+}
@@ -0,0 +1,133 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+/*
+ * What the benchmarks share: one made-up screen, and made-up clients on
+ * it with just a frame and a geometry. Nothing here talks to the server,
+ * so dpy stays NULL. Xlib won't keep contexts without a display, though,
+ * so we keep them ourselves, in a table big enough for any benchmark;
+ * these take the place of Xlib's own when linked in, and FIND_CTX never
+ * knows the difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../aewm.h"
+#include "bench.h"
+
+#define NCTX 16384
+
+static struct {
+    XID w;
+    XContext ctx;
+    XPointer data;
+    Bool live;
+} ctxs[NCTX];
+
+static unsigned int ctx_slot(XID w, XContext ctx);
+
+static Window next_xid = 0x100;
+
+void bench_screen(int w, int h, int max_wins)
+{
+    static ScreenInfo s;
+    static XFontStruct xfs;
+#ifdef XFT
+    static XftFont xf;
+#endif
+
+    xfs.ascent = 12;
+    xfs.descent = 3;
+    font = &xfs;
+#ifdef XFT
+    xf.ascent = 12;
+    xf.descent = 3;
+    xftfont = &xf;
+#endif
+    frame_tab = XUniqueContext();
+    cli_tab = XUniqueContext();
+    screens = scr = &s;
+    nscreens = 1;
+    s.rw = s.desk_w = w;
+    s.rh = s.desk_h = h;
+    s.ndesks = 1;
+    s.outputs[0].w = w;
+    s.outputs[0].h = h;
+    s.noutputs = 1;
+    if (max_wins < 1 || max_wins > NCTX / 4 ||
+            !(s.wins = malloc(max_wins * sizeof *s.wins))) {
+        fprintf(stderr, "bench: can't have %d windows\n", max_wins);
+        exit(2);
+    }
+}
+
+Client *bench_client(long x, long y, long w, long h)
+{
+    Client *c = calloc(1, sizeof *c);
+
+    c->scr = scr;
+    c->win = next_xid++;
+    c->frame = next_xid++;
+    c->geom.x = x;
+    c->geom.y = y;
+    c->geom.w = w;
+    c->geom.h = h;
+    c->decor = True;
+    c->mapped = True;
+    XSaveContext(dpy, c->win, cli_tab, (XPointer)c);
+    XSaveContext(dpy, c->frame, frame_tab, (XPointer)c);
+    return c;
+}
+
+double bench_usec(struct timeval *start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) * 1e6 +
+        (now.tv_usec - start->tv_usec);
+}
+
+int XSaveContext(Display *d, XID w, XContext ctx, _Xconst char *data)
+{
+    unsigned int i = ctx_slot(w, ctx);
+
+    ctxs[i].w = w;
+    ctxs[i].ctx = ctx;
+    ctxs[i].data = (XPointer)data;
+    ctxs[i].live = True;
+    return 0;
+}
+
+int XFindContext(Display *d, XID w, XContext ctx, XPointer *data)
+{
+    unsigned int i = ctx_slot(w, ctx);
+
+    if (!ctxs[i].live)
+        return XCNOENT;
+    *data = ctxs[i].data;
+    return 0;
+}
+
+int XDeleteContext(Display *d, XID w, XContext ctx)
+{
+    unsigned int i = ctx_slot(w, ctx);
+
+    if (!ctxs[i].live)
+        return XCNOENT;
+    ctxs[i].live = False;
+    return 0;
+}
+
+/* Where (w, ctx) is, or the empty slot it would go in. Deleted entries
+ * keep their slot, so nothing after them goes missing. */
+
+static unsigned int ctx_slot(XID w, XContext ctx)
+{
+    unsigned int i = (w * 31 + ctx) % NCTX;
+
+    while (ctxs[i].w && (ctxs[i].w != w || ctxs[i].ctx != ctx))
+        i = (i + 1) % NCTX;
+    return i;
+}
@@ -0,0 +1,14 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+#ifndef AEWM_BENCH_H
+#define AEWM_BENCH_H
+
+#include <sys/time.h>
+
+extern void bench_screen(int w, int h, int max_wins);
+extern Client *bench_client(long x, long y, long w, long h);
+extern double bench_usec(struct timeval *start);
+
+#endif /* AEWM_BENCH_H */
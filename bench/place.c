@@ -0,0 +1,63 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+/*
+ * Times smart placement (cli_place) and the braces it fits clients into
+ * (desk_braces_sum) with a few hundred clients on one desk, one of them a
+ * panel with a strut, without an X server.
+ *
+ * "make bench", then "bench/place [clients [rounds]]".
+ */
+
+#define main aewm_main
+#include "../aewm_init.c"
+#undef main
+#include "../aewm_client.c"
+#include "bench.h"
+
+int main(int argc, char **argv)
+{
+    int nclients = argc > 1 ? atoi(argv[1]) : 500;
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    int i;
+    long sum = 0;
+    Client *c;
+    Brace b;
+    struct timeval start;
+    double braces_us, place_us;
+
+    bench_screen(1920, 1080, nclients);
+    srand(1);
+    c = bench_client(0, scr->rh - 24, scr->rw, 24);
+    c->decor = False;
+    c->desk = DESK_ALL;
+    c->nstrut = 4;
+    c->strut[3] = 24;
+    scr->wins[scr->nwins++] = c->win;
+    while ((int)scr->nwins < nclients) {
+        c = bench_client(rand() % (scr->rw - 200), rand() % (scr->rh - 150),
+            200 + rand() % 500, 150 + rand() % 350);
+        scr->wins[scr->nwins++] = c->frame;
+    }
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < rounds; i++) {
+        b = desk_braces_sum(0, 0);
+        sum += b.b;
+    }
+    braces_us = bench_usec(&start) / rounds;
+
+    c = bench_client(0, 0, 640, 480);
+    gettimeofday(&start, NULL);
+    for (i = 0; i < rounds; i++) {
+        c->geom.x = c->geom.y = 0;
+        cli_place(c, b);
+        sum += c->geom.x + c->geom.y;
+    }
+    place_us = bench_usec(&start) / rounds;
+
+    printf("%d clients: desk_braces_sum %.2f us, cli_place %.2f us "
+        "(%ld)\n", nclients, braces_us, place_us, sum);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+/*
+ * Times the edge index behind opt_sn (aewm_snap.c) with a few hundred
+ * clients on one desk, without an X server: filling it, keeping it up to
+ * date as one client moves (what cli_index does on every step of an
+ * opaque sweep, along with the grid), and looking for something to snap
+ * to.
+ *
+ * "make bench", then "bench/snap [clients [rounds]]".
+ */
+
+#define main aewm_main
+#include "../aewm_init.c"
+#undef main
+#include "../aewm_snap.c"
+#include "bench.h"
+
+int main(int argc, char **argv)
+{
+    int nclients = argc > 1 ? atoi(argv[1]) : 500;
+    int rounds = argc > 2 ? atoi(argv[2]) : 2000;
+    int i;
+    long sum = 0;
+    Client **cs, *c;
+    Brace b;
+    struct timeval start;
+    double fill_us, index_us, both_us, move_us, remove_us;
+
+    bench_screen(1920, 1080, nclients);
+    if (!(cs = malloc(nclients * sizeof *cs)))
+        return 2;
+    opt_sn = 10;
+    srand(1);
+    while ((int)scr->nwins < nclients) {
+        c = bench_client(rand() % (scr->rw - 200), rand() % (scr->rh - 150),
+            200 + rand() % 500, 150 + rand() % 350);
+        cs[scr->nwins] = c;
+        scr->wins[scr->nwins++] = c->frame;
+    }
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < nclients; i++)
+        snap_index(cs[i]);
+    fill_us = bench_usec(&start) / nclients;
+
+    /* One client dragged across the screen, a pixel at a time. */
+    c = cs[nclients / 2];
+    gettimeofday(&start, NULL);
+    for (i = 0; i < rounds; i++) {
+        c->geom.x = i % (scr->rw - c->geom.w);
+        snap_index(c);
+    }
+    index_us = bench_usec(&start) / rounds;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < rounds; i++) {
+        c->geom.y = i % (scr->rh - c->geom.h);
+        cli_index(c);
+    }
+    both_us = bench_usec(&start) / rounds;
+
+    b.l = b.t = 0;
+    b.r = scr->rw;
+    b.b = scr->rh;
+    gettimeofday(&start, NULL);
+    for (i = 0; i < rounds; i++) {
+        c->geom.x = i % (scr->rw - c->geom.w);
+        c->geom.y = i % (scr->rh - c->geom.h);
+        snap_move(c, &b);
+        sum += c->geom.x + c->geom.y;
+    }
+    move_us = bench_usec(&start) / rounds;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < nclients; i++)
+        snap_remove(cs[i]);
+    remove_us = bench_usec(&start) / nclients;
+
+    printf("%d clients: fill %.2f us/client, snap_index %.2f us, "
+        "cli_index %.2f us, snap_move %.2f us, snap_remove %.2f us "
+        "(%ld)\n", nclients, fill_us, index_us, both_us, move_us,
+        remove_us, sum);
+    return 0;
+}
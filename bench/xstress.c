@@ -0,0 +1,256 @@
+/*-
+ * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
+ */
+
+/*
+ * Loads whatever window manager is running (or none) with busy clients.
+ * It maps some windows, then, for as long as it's asked to, moves,
+ * resizes and redraws every one of them in rounds, unmapping and mapping
+ * one again each round. A round is over when every window has heard that
+ * it got its new size, so rounds/s is how fast the window manager keeps
+ * up. Unlike the other benchmarks this one needs an X server; with
+ * "aewm --composite", send aewm SIGUSR1 afterwards for its frame rate and
+ * repaint area.
+ *
+ * Kinds of window are letters, used in turn: o is opaque, s is shaped
+ * (only with SHAPE), a is ARGB, drawn half transparent. Kinds separated
+ * by commas are run one after the other, each with windows of its own,
+ * so "o,a" gives the cost of translucency (ARGB clients, and the ARGB
+ * frames aewm gives them) next to that of plain windows, on one server.
+ *
+ * "bench/xstress [kinds [windows [seconds]]]", by default "osa 30 10".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#ifdef SHAPE
+#include <X11/extensions/shape.h>
+#endif
+
+#define BASE_W 160
+#define BASE_H 120
+#define SETTLE 1000000L  /* usec to wait for a round before giving up */
+
+typedef struct {
+    Window win;
+    GC gc;
+    char kind;
+    int w, h;            /* size we last asked for... */
+    Bool done;           /* ... and whether we've been told we got it */
+} Win;
+
+static Display *dpy;
+static Win *wins;
+static int nwins;
+static XVisualInfo argb;
+static Colormap argb_cmap;
+
+static void run(char *, int, int, int);
+static void win_make(Win *, char);
+static void win_round(Win *, int);
+static int wait_for(int, int, long);
+static double usec_since(struct timeval *);
+
+int main(int argc, char **argv)
+{
+    char *kinds = argc > 1 ? argv[1] : "osa";
+    int n = argc > 2 ? atoi(argv[2]) : 30;
+    int seconds = argc > 3 ? atoi(argv[3]) : 10;
+    char *k;
+    int len;
+
+    if (!*kinds || n < 1 || seconds < 1 ||
+            strspn(kinds, "osa,") != strlen(kinds) || strstr(kinds, ",,") ||
+            *kinds == ',' || kinds[strlen(kinds) - 1] == ',') {
+        fprintf(stderr, "usage: xstress [osa,...] [windows [seconds]]\n");
+        return 2;
+    }
+    if (!(dpy = XOpenDisplay(NULL))) {
+        fprintf(stderr, "xstress: can't open display\n");
+        return 1;
+    }
+#ifndef SHAPE
+    if (strchr(kinds, 's')) {
+        fprintf(stderr, "xstress: built without SHAPE\n");
+        return 1;
+    }
+#endif
+    if (strchr(kinds, 'a')) {
+        if (!XMatchVisualInfo(dpy, DefaultScreen(dpy), 32, TrueColor,
+                &argb)) {
+            fprintf(stderr, "xstress: no 32-bit visual for ARGB windows\n");
+            return 1;
+        }
+        argb_cmap = XCreateColormap(dpy, DefaultRootWindow(dpy),
+            argb.visual, AllocNone);
+    }
+
+    for (k = kinds; *k; k += len + (k[len] == ',')) {
+        len = strcspn(k, ",");
+        run(k, len, n, seconds);
+    }
+    XCloseDisplay(dpy);
+    return 0;
+}
+
+/* One pass: n windows of the first len kinds, for this many seconds. */
+
+static void run(char *kinds, int len, int n, int seconds)
+{
+    int i, round, stalls = 0;
+    struct timeval start;
+    double us;
+
+    nwins = n;
+    wins = calloc(nwins, sizeof *wins);
+    for (i = 0; i < nwins; i++)
+        win_make(&wins[i], kinds[i % len]);
+    for (i = 0; i < nwins; i++)
+        XMapWindow(dpy, wins[i].win);
+    XSync(dpy, False);
+    wait_for(nwins, MapNotify, 5 * SETTLE);
+
+    gettimeofday(&start, NULL);
+    for (round = 0; usec_since(&start) < seconds * 1e6; round++) {
+        for (i = 0; i < nwins; i++)
+            win_round(&wins[i], round);
+        XUnmapWindow(dpy, wins[round % nwins].win);
+        XMapWindow(dpy, wins[round % nwins].win);
+        if (wait_for(nwins, ConfigureNotify, SETTLE))
+            stalls++;
+    }
+    us = usec_since(&start);
+
+    printf("%d windows (%.*s): %d rounds, %.1f rounds/s, %.2f ms/round, "
+        "%d stalled\n", nwins, len, kinds, round, round * 1e6 / us,
+        us / 1000 / round, stalls);
+    fflush(stdout);
+
+    for (i = 0; i < nwins; i++) {
+        XFreeGC(dpy, wins[i].gc);
+        XDestroyWindow(dpy, wins[i].win);
+    }
+    XSync(dpy, True);
+    free(wins);
+}
+
+static void win_make(Win *w, char kind)
+{
+    XSetWindowAttributes attr;
+    XSizeHints hints;
+    int scr = DefaultScreen(dpy);
+
+    w->kind = kind;
+    w->w = BASE_W;
+    w->h = BASE_H;
+    if (kind == 'a') {
+        attr.colormap = argb_cmap;
+        attr.background_pixel = 0;
+        attr.border_pixel = 0;
+        w->win = XCreateWindow(dpy, RootWindow(dpy, scr), 0, 0, w->w, w->h,
+            0, 32, InputOutput, argb.visual,
+            CWColormap|CWBackPixel|CWBorderPixel, &attr);
+    } else {
+        w->win = XCreateSimpleWindow(dpy, RootWindow(dpy, scr), 0, 0,
+            w->w, w->h, 0, BlackPixel(dpy, scr), WhitePixel(dpy, scr));
+    }
+    XStoreName(dpy, w->win, "xstress");
+    hints.flags = USPosition|USSize;
+    XSetWMNormalHints(dpy, w->win, &hints);
+    XSelectInput(dpy, w->win, StructureNotifyMask);
+    w->gc = XCreateGC(dpy, w->win, 0, NULL);
+}
+
+/* Ask for a new place and size, different from last time's, then fill the
+ * window and, if it's shaped, cut it into a cross of that size. Half
+ * transparent is 0x80 alpha, with the colors premultiplied. */
+
+static void win_round(Win *w, int round)
+{
+    int i = w - wins;
+    int sw = DisplayWidth(dpy, DefaultScreen(dpy)) - 2 * BASE_W;
+    int sh = DisplayHeight(dpy, DefaultScreen(dpy)) - 2 * BASE_H;
+    unsigned long shade = (round * 8 + i * 16) & 0x7f;
+#ifdef SHAPE
+    XRectangle cross[2];
+#endif
+
+    w->w = BASE_W + (round & 1) * BASE_W / 2 + i % 4;
+    w->h = BASE_H + (round & 1) * BASE_H / 2 + i % 4;
+    w->done = False;
+    XMoveResizeWindow(dpy, w->win, (i * 53 + round * 7) % (sw > 0 ? sw : 1),
+        (i * 31 + round * 5) % (sh > 0 ? sh : 1), w->w, w->h);
+
+    if (w->kind == 'a')
+        XSetForeground(dpy, w->gc, 0x80UL << 24 | shade << 16 | shade);
+    else
+        XSetForeground(dpy, w->gc, (shade * 2) << 8 | 0x40);
+    XFillRectangle(dpy, w->win, w->gc, 0, 0, w->w, w->h);
+#ifdef SHAPE
+    if (w->kind == 's') {
+        cross[0].x = 0;
+        cross[0].y = w->h / 3;
+        cross[0].width = w->w;
+        cross[0].height = w->h / 3;
+        cross[1].x = w->w / 3;
+        cross[1].y = 0;
+        cross[1].width = w->w / 3;
+        cross[1].height = w->h;
+        XShapeCombineRectangles(dpy, w->win, ShapeBounding, 0, 0, cross, 2,
+            ShapeSet, Unsorted);
+    }
+#endif
+}
+
+/* Read events until n windows have had an event of this type (for a
+ * ConfigureNotify, with the size they asked for), or usec have gone by.
+ * Returns how many were still waiting. */
+
+static int wait_for(int n, int type, long usec)
+{
+    XEvent ev;
+    struct timeval start, tv;
+    fd_set fds;
+    double left;
+    int i;
+
+    gettimeofday(&start, NULL);
+    while (n > 0) {
+        while (n > 0 && XPending(dpy)) {
+            XNextEvent(dpy, &ev);
+            for (i = 0; i < nwins; i++)
+                if (wins[i].win == ev.xany.window) break;
+            if (i == nwins || wins[i].done)
+                continue;
+            if (ev.type == type && (type != ConfigureNotify ||
+                    (ev.xconfigure.width == wins[i].w &&
+                    ev.xconfigure.height == wins[i].h))) {
+                wins[i].done = True;
+                n--;
+            }
+        }
+        if (n == 0 || (left = usec - usec_since(&start)) <= 0)
+            break;
+        tv.tv_sec = left / 1e6;
+        tv.tv_usec = (long)left % 1000000;
+        FD_ZERO(&fds);
+        FD_SET(ConnectionNumber(dpy), &fds);
+        if (select(ConnectionNumber(dpy) + 1, &fds, NULL, NULL, &tv) <= 0)
+            break;
+    }
+    return n;
+}
+
+static double usec_since(struct timeval *start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) * 1e6 +
+        (now.tv_usec - start->tv_usec);
+}
@@ -17,3 +17,8 @@ padding 3
 button1 "aemenu"
 button2 "xterm"
 button3 "aemenu --switch"
+
+# Keys and buttons that aewm handles itself (see the manual page)
+bind Mod4+Return exec xterm
+bind Mod4+F4 close
+bind Mod4+Escape iconify
@@ -2,9 +2,12 @@
 
 OBJ = aesession.o
 X11OBJ = aedesk.o lib/menu.o lib/util.o
-WMOBJ = aewm_init.o aewm_client.o aewm_event.o aewm_manip.o
+WMOBJ = aewm_init.o aewm_client.o aewm_event.o aewm_manip.o aewm_title.o \
+	aewm_comp.o aewm_snap.o aewm_tile.o \
+	aewm_grid.o aewm_view.o aewm_output.o aewm_bind.o
 GTKOBJ = aemenu.o aepanel.o
-ALLOBJ = $(OBJ) $(X11OBJ) $(WMOBJ) $(GTKOBJ)
+BENCHOBJ = bench/bench.o bench/place.o bench/snap.o bench/xstress.o
+ALLOBJ = $(OBJ) $(X11OBJ) $(WMOBJ) $(GTKOBJ) $(BENCHOBJ)
 WM_H = aewm.h
 
 BIN = aesession
@@ -12,6 +15,7 @@ X11BIN = aedesk
 WMBIN = aewm
 GTKBIN = aemenu aepanel
 ALLBIN = $(BIN) $(X11BIN) $(WMBIN) $(GTKBIN)
+BENCHBIN = bench/place bench/snap bench/xstress
 
 X11FLAGS = -I$(XROOT)/include
 WMFLAGS = $(X11FLAGS) $(OPT_WMFLAGS)
@@ -32,7 +36,20 @@ aemenu: aemenu.o lib/menu.o lib/util.o
 aepanel: aepanel.o lib/menu.o lib/util.o
 aewm: $(WMOBJ) lib/util.o
 
+# Benchmarks, built with "make bench" but not installed. Each one includes
+# aewm_init.c and the file it times, and links against the rest of aewm
+# and bench/bench.o, except for xstress, which is just an X client.
+BENCH_WMOBJ = aewm_event.o aewm_manip.o aewm_title.o aewm_comp.o \
+	aewm_tile.o aewm_grid.o aewm_view.o aewm_output.o aewm_bind.o lib/util.o
+bench: $(BENCHBIN)
+bench/place: bench/place.o bench/bench.o aewm_snap.o $(BENCH_WMOBJ)
+bench/snap: bench/snap.o bench/bench.o aewm_client.o $(BENCH_WMOBJ)
+bench/xstress: bench/xstress.o
+
 $(WMOBJ): $(WM_H)
+bench/bench.o: $(WM_H) bench/bench.h
+bench/place.o: $(WM_H) bench/bench.h aewm_init.c aewm_client.c
+bench/snap.o: $(WM_H) bench/bench.h aewm_init.c aewm_snap.c
 
 install: all
 	mkdir -p $(BINDIR) $(MANDIR) $(CFGDIR)
@@ -49,6 +66,6 @@ install: all
 	done
 
 clean:
-	rm -f $(ALLBIN) $(ALLOBJ)
+	rm -f $(ALLBIN) $(BENCHBIN) $(ALLOBJ)
 
-.PHONY: all install clean
+.PHONY: all bench install clean
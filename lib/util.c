@@ -2,12 +2,19 @@
  * aewm: Copyright (c) 1998-2008 Decklin Foster. See README for license.
  */
 
+/* For POSIX_SPAWN_SETSID, which glibc only shows us with this. */
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
 #include <ctype.h>
+#include <time.h>
+#include <signal.h>
+#include <spawn.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <X11/Xlib.h>
 #include <X11/Xmd.h>
 #include <X11/Xutil.h>
@@ -22,6 +29,7 @@ Atom wm_state;
 Atom wm_change_state;
 Atom wm_protos;
 Atom wm_delete;
+Atom mwm_hints;
 Atom net_supported;
 Atom net_client_list;
 Atom net_client_stack;
@@ -36,6 +44,14 @@ Atom net_wm_state_shaded;
 Atom net_wm_state_mv;
 Atom net_wm_state_mh;
 Atom net_wm_state_fs;
+Atom net_wm_sync_req;
+Atom net_wm_sync_counter;
+Atom net_wm_moveresize;
+Atom net_moveresize_window;
+Atom net_frame_extents;
+Atom net_req_frame_extents;
+Atom net_desk_geom;
+Atom net_desk_viewport;
 Atom net_wm_state_skipt;
 Atom net_wm_state_skipp;
 Atom net_wm_strut;
@@ -46,21 +62,109 @@ Atom net_wm_type_dock;
 Atom net_wm_type_menu;
 Atom net_wm_type_splash;
 
+SpawnStats spawn_stats;
+
+extern char **environ;
+
 static char *atom_str_get(Window, Atom, Atom);
+static long time_usec(void);
+
+/*
+ * Start cmd in the background, and return its pid, or -1 if it couldn't be
+ * started. Most commands we're given are just a program and some words to
+ * pass it, so unless there's something in there for the shell to do, we
+ * run the program directly rather than having /bin/sh parse it first.
+ *
+ * posix_spawn doesn't copy our address space the way fork() does, and it
+ * doesn't come back until the child has exec'd (or failed to), so how
+ * long it takes is the whole fork-to-exec time. We keep count of that in
+ * spawn_stats.
+ *
+ * The child is in a session (or, failing that, a process group) of its
+ * own, and it's up to the caller to reap it, with spawn_reap or otherwise.
+ */
 
-void fork_exec(char *cmd)
+pid_t spawn(char *cmd)
 {
-    pid_t pid = fork();
-
-    switch (pid) {
-        case 0:
-            setsid();
-            execlp("/bin/sh", "sh", "-c", cmd, NULL);
-            fprintf(stderr, "exec failed, cleaning up child\n");
-            exit(1);
-        case -1:
-            fprintf(stderr, "can't fork\n");
+    char buf[BUF_SIZE], *args[SPAWN_ARGS], *p;
+    posix_spawnattr_t attr;
+    sigset_t none;
+    pid_t pid;
+    long start, took;
+    int n = 0, direct, err;
+
+    if (!strpbrk(cmd, SPAWN_META) && strlen(cmd) < sizeof buf) {
+        strcpy(buf, cmd);
+        for (p = strtok(buf, " \t"); p && n < SPAWN_ARGS - 1;
+                p = strtok(NULL, " \t"))
+            args[n++] = p;
+        if (p) n = 0;
+    }
+    if (!(direct = n > 0)) {
+        args[n++] = "sh";
+        args[n++] = "-c";
+        args[n++] = cmd;
+    }
+    args[n] = NULL;
+
+    sigemptyset(&none);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &none);
+#ifdef POSIX_SPAWN_SETSID
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK|POSIX_SPAWN_SETSID);
+#else
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr,
+        POSIX_SPAWN_SETSIGMASK|POSIX_SPAWN_SETPGROUP);
+#endif
+
+    start = time_usec();
+    err = direct ? posix_spawnp(&pid, args[0], NULL, &attr, args, environ)
+                 : posix_spawn(&pid, "/bin/sh", NULL, &attr, args, environ);
+    took = time_usec() - start;
+    posix_spawnattr_destroy(&attr);
+
+    if (err) {
+        fprintf(stderr, "can't run '%s': %s\n", cmd, strerror(err));
+        spawn_stats.failed++;
+        return -1;
     }
+    spawn_stats.started++;
+    if (direct) spawn_stats.direct++;
+    spawn_stats.usec_total += took;
+    if (took > spawn_stats.usec_max)
+        spawn_stats.usec_max = took;
+    return pid;
+}
+
+/* Wait for any children that have exited, without blocking. One SIGCHLD
+ * may stand for several of them, so we keep going until there are none. */
+
+void spawn_reap(void)
+{
+    int status;
+
+    while (waitpid(-1, &status, WNOHANG) > 0)
+        spawn_stats.reaped++;
+}
+
+/* Milliseconds on a clock that never jumps. Only differences between two
+ * readings mean anything. */
+
+long time_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static long time_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
 /* If the user specifies an rc file, return NULL immediately if it's not
@@ -7,6 +7,7 @@
 
 #include <X11/Xlib.h>
 #include <stdio.h>
+#include <sys/types.h>
 
 #define SYS_RC_DIR "/etc/X11/aewm"
 #define DESK_ALL 0xFFFFFFFF
@@ -17,6 +18,19 @@
     strcmp(argv[i], "-" short) == 0) && i + (nargs) < argc)
 #define RC_OPT(name) (strcmp(token, name) == 0 && tok_next(&p, token))
 
+/* Anything in a command that would need the shell to make sense of it. */
+#define SPAWN_META "|&;<>()$`\\\"'*?[]#~={}\n"
+#define SPAWN_ARGS 64
+
+typedef struct {
+    unsigned long started;  /* commands we got running */
+    unsigned long direct;   /* ... without a shell in between */
+    unsigned long failed;   /* ones we couldn't */
+    unsigned long reaped;   /* children spawn_reap waited for */
+    long usec_total;        /* time spent starting them */
+    long usec_max;          /* ... and the longest it took */
+} SpawnStats;
+
 extern Display *dpy;
 extern Window root;
 extern int screen;
@@ -25,6 +39,7 @@ extern Atom wm_state;
 extern Atom wm_change_state;
 extern Atom wm_protos;
 extern Atom wm_delete;
+extern Atom mwm_hints;
 extern Atom net_supported;
 extern Atom net_client_list;
 extern Atom net_client_stack;
@@ -39,6 +54,14 @@ extern Atom net_wm_state_shaded;
 extern Atom net_wm_state_mv;
 extern Atom net_wm_state_mh;
 extern Atom net_wm_state_fs;
+extern Atom net_wm_sync_req;
+extern Atom net_wm_sync_counter;
+extern Atom net_wm_moveresize;
+extern Atom net_moveresize_window;
+extern Atom net_frame_extents;
+extern Atom net_req_frame_extents;
+extern Atom net_desk_geom;
+extern Atom net_desk_viewport;
 extern Atom net_wm_state_skipt;
 extern Atom net_wm_state_skipp;
 extern Atom net_wm_strut;
@@ -49,7 +72,11 @@ extern Atom net_wm_type_dock;
 extern Atom net_wm_type_menu;
 extern Atom net_wm_type_splash;
 
-extern void fork_exec(char *);
+extern SpawnStats spawn_stats;
+
+extern pid_t spawn(char *);
+extern void spawn_reap(void);
+extern long time_msec(void);
 extern FILE *rc_open(const char *, const char *);
 extern char *rc_getl(char *, int, FILE *);
 extern int tok_next(char **, char *);
@@ -13,9 +13,13 @@
 #define DEF_BW 1
 #define DEF_PAD 3
 #define DEF_MT 0
+#define DEF_TR 20
+#define DEF_HT 0
+#define DEF_SR 60
+#define DEF_SN 0
+#define DEF_DW 0
+#define DEF_DH 0
 
 #define DEF_NEW1 "aemenu --switch"
 #define DEF_NEW2 "xterm"
 #define DEF_NEW3 "aemenu --launch"
-#define DEF_NEW4 "aedesk -1"
-#define DEF_NEW5 "aedesk +1"
@@ -18,8 +18,30 @@ CFGDIR = $(PREFIX)/etc/aewm
 #OPT_WMLIB += -lXext
 
 # Uncomment to add Xft support
-#OPT_WMFLAGS += -DXFT `pkg-config --cflags xft`
-#OPT_WMLIB += `pkg-config --libs xft` -lXext
+#OPT_WMFLAGS += -DXFT `pkg-config --cflags xft fontconfig`
+#OPT_WMLIB += `pkg-config --libs xft fontconfig` -lXext
+
+# Uncomment to draw core font titles through XRender (Xft always does)
+#OPT_WMFLAGS += -DRENDER
+#OPT_WMLIB += -lXrender
+
+# Uncomment to composite windows ourselves (with --composite)
+#OPT_WMFLAGS += -DCOMPOSITE
+#OPT_WMLIB += -lXcomposite -lXdamage -lXfixes -lXrender -lXext
+
+# Uncomment to pace opaque resizes to clients that support
+# _NET_WM_SYNC_REQUEST
+#OPT_WMFLAGS += -DSYNC
+#OPT_WMLIB += -lXext
+
+# Uncomment to track the pointer through XInput 2 while moving and resizing
+#OPT_WMFLAGS += -DXI2
+#OPT_WMLIB += -lXi
+
+# Uncomment to keep windows to one monitor each, and follow monitors
+# being added, removed or moved, through RandR 1.3
+#OPT_WMFLAGS += -DRANDR
+#OPT_WMLIB += -lXrandr
 
 # Uncomment to print debugging info
 #OPT_WMFLAGS += -DDEBUG